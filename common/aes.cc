@@ -0,0 +1,456 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#include "aes.h"
+#include "cpu.h"
+
+static AesBackend compute_aes_backend_() {
+  AesBackend backend = cpu_has_aesni() ? AES_BACKEND_AESNI : AES_BACKEND_OPENSSL;
+
+  const char *name = getenv("CRYPTOPALS_AES");
+  if (name && parse_aes_backend(name, &backend) < 0)
+    fprintf(stderr, "%s: ignoring unknown CRYPTOPALS_AES [%s]\n",
+            __FUNCTION__, name);
+  if (backend == AES_BACKEND_AESNI && !cpu_has_aesni())
+    backend = AES_BACKEND_OPENSSL;
+  return backend;
+}
+
+AesBackend default_aes_backend() {
+  static const AesBackend backend = compute_aes_backend_();
+  return backend;
+}
+
+int parse_aes_backend(const char *name, AesBackend *backend) {
+  if (!strcmp(name, "table")) {
+    *backend = AES_BACKEND_TABLE;
+  } else if (!strcmp(name, "aesni")) {
+    *backend = AES_BACKEND_AESNI;
+  } else if (!strcmp(name, "openssl")) {
+    *backend = AES_BACKEND_OPENSSL;
+  } else {
+    return -1;
+  }
+  return 0;
+}
+
+// multiplication by x in GF(2^8)
+static unsigned char xtime_(unsigned char a) {
+  return (a << 1) ^ (a & 0x80 ? 0x1b : 0);
+}
+
+static unsigned char gf_mul_(unsigned char a, unsigned char b) {
+  unsigned char product = 0;
+  for (; b; b >>= 1, a = xtime_(a)) {
+    if (b & 1)
+      product ^= a;
+  }
+  return product;
+}
+
+static uint32_t rotr_(uint32_t x, int bits) {
+  return (x >> bits) | (x << (32 - bits));
+}
+
+// The s-boxes and the round tables merging SubBytes, ShiftRows and
+// (Inv)MixColumns, one rotation of the column per table.
+class AesTables_ {
+ public:
+  AesTables_() {
+    // walk GF(2^8)* with p = 3^i and q = 3^-i, so q is p's inverse
+    unsigned char p = 1, q = 1;
+    do {
+      p = p ^ xtime_(p);
+      q ^= q << 1;
+      q ^= q << 2;
+      q ^= q << 4;
+      if (q & 0x80)
+        q ^= 0x09;
+      const unsigned char affine = q ^ (q << 1 | q >> 7) ^ (q << 2 | q >> 6) ^
+          (q << 3 | q >> 5) ^ (q << 4 | q >> 4);
+      sbox[p] = affine ^ 0x63;
+    } while (p != 1);
+    sbox[0] = 0x63;
+
+    for (int x = 0; x < 256; ++x) {
+      const unsigned char s = sbox[x];
+      inv_sbox[s] = x;
+
+      te[0][x] = (gf_mul_(s, 2) << 24) | (s << 16) | (s << 8) | gf_mul_(s, 3);
+      td[0][s] = (gf_mul_(x, 0x0e) << 24) | (gf_mul_(x, 0x09) << 16) |
+          (gf_mul_(x, 0x0d) << 8) | gf_mul_(x, 0x0b);
+    }
+    for (int x = 0; x < 256; ++x) {
+      for (int t = 1; t < 4; ++t) {
+        te[t][x] = rotr_(te[0][x], 8 * t);
+        td[t][x] = rotr_(td[0][x], 8 * t);
+      }
+    }
+  }
+
+  unsigned char sbox[256];
+  unsigned char inv_sbox[256];
+  uint32_t te[4][256];
+  uint32_t td[4][256];
+};
+
+static const AesTables_ &aes_tables_() {
+  static const AesTables_ tables;
+  return tables;
+}
+
+static uint32_t load_be_(const unsigned char *p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static void store_be_(unsigned char *p, uint32_t x) {
+  p[0] = x >> 24;
+  p[1] = x >> 16;
+  p[2] = x >> 8;
+  p[3] = x;
+}
+
+Aes128::Aes128(const AesBackend backend)
+    : aesni_(backend == AES_BACKEND_AESNI && cpu_has_aesni()) {
+  memset(enc_, 0, sizeof(enc_));
+  memset(dec_, 0, sizeof(dec_));
+  memset(enc_bytes_, 0, sizeof(enc_bytes_));
+  memset(dec_bytes_, 0, sizeof(dec_bytes_));
+}
+
+void Aes128::set_key(const unsigned char *key) {
+  const AesTables_ &tables = aes_tables_();
+  const unsigned char *sbox = tables.sbox;
+
+  unsigned char rcon = 1;
+  for (int i = 0; i < 4; ++i)
+    enc_[i] = load_be_(key + 4 * i);
+  for (int i = 4; i < 4 * (ROUNDS_ + 1); ++i) {
+    uint32_t t = enc_[i - 1];
+    if (!(i % 4)) {
+      // RotWord, SubWord, Rcon
+      t = ((uint32_t)sbox[(t >> 16) & 0xff] << 24) | ((uint32_t)sbox[(t >> 8) & 0xff] << 16) |
+          ((uint32_t)sbox[t & 0xff] << 8) | sbox[t >> 24];
+      t ^= (uint32_t)rcon << 24;
+      rcon = xtime_(rcon);
+    }
+    enc_[i] = enc_[i - 4] ^ t;
+  }
+
+  // the equivalent inverse cipher runs the round keys backwards, with
+  // InvMixColumns applied to all but the outer ones; td[] of sbox[b]
+  // is InvMixColumns of b alone
+  for (int round = 0; round <= ROUNDS_; ++round) {
+    for (int j = 0; j < 4; ++j) {
+      const uint32_t w = enc_[4 * (ROUNDS_ - round) + j];
+      if (!round || round == ROUNDS_) {
+        dec_[4 * round + j] = w;
+        continue;
+      }
+      dec_[4 * round + j] = tables.td[0][sbox[w >> 24]] ^ tables.td[1][sbox[(w >> 16) & 0xff]] ^
+          tables.td[2][sbox[(w >> 8) & 0xff]] ^ tables.td[3][sbox[w & 0xff]];
+    }
+  }
+
+  for (int i = 0; i < 4 * (ROUNDS_ + 1); ++i) {
+    store_be_(enc_bytes_ + 4 * i, enc_[i]);
+    store_be_(dec_bytes_ + 4 * i, dec_[i]);
+  }
+}
+
+static void encrypt_block_table_(const uint32_t *rk, unsigned char *out, const unsigned char *in) {
+  const AesTables_ &tables = aes_tables_();
+  const uint32_t (*te)[256] = tables.te;
+  const unsigned char *sbox = tables.sbox;
+
+  uint32_t s0 = load_be_(in) ^ rk[0];
+  uint32_t s1 = load_be_(in + 4) ^ rk[1];
+  uint32_t s2 = load_be_(in + 8) ^ rk[2];
+  uint32_t s3 = load_be_(in + 12) ^ rk[3];
+  for (int round = 1; round < 10; ++round) {
+    rk += 4;
+    const uint32_t t0 = te[0][s0 >> 24] ^ te[1][(s1 >> 16) & 0xff] ^
+        te[2][(s2 >> 8) & 0xff] ^ te[3][s3 & 0xff] ^ rk[0];
+    const uint32_t t1 = te[0][s1 >> 24] ^ te[1][(s2 >> 16) & 0xff] ^
+        te[2][(s3 >> 8) & 0xff] ^ te[3][s0 & 0xff] ^ rk[1];
+    const uint32_t t2 = te[0][s2 >> 24] ^ te[1][(s3 >> 16) & 0xff] ^
+        te[2][(s0 >> 8) & 0xff] ^ te[3][s1 & 0xff] ^ rk[2];
+    const uint32_t t3 = te[0][s3 >> 24] ^ te[1][(s0 >> 16) & 0xff] ^
+        te[2][(s1 >> 8) & 0xff] ^ te[3][s2 & 0xff] ^ rk[3];
+    s0 = t0;
+    s1 = t1;
+    s2 = t2;
+    s3 = t3;
+  }
+
+  // no MixColumns in the last round
+  rk += 4;
+  const uint32_t s[4] = {s0, s1, s2, s3};
+  for (int j = 0; j < 4; ++j) {
+    store_be_(out + 4 * j,
+              (((uint32_t)sbox[s[j] >> 24] << 24) | ((uint32_t)sbox[(s[(j + 1) % 4] >> 16) & 0xff] << 16) |
+               ((uint32_t)sbox[(s[(j + 2) % 4] >> 8) & 0xff] << 8) | sbox[s[(j + 3) % 4] & 0xff]) ^ rk[j]);
+  }
+}
+
+static void decrypt_block_table_(const uint32_t *rk, unsigned char *out, const unsigned char *in) {
+  const AesTables_ &tables = aes_tables_();
+  const uint32_t (*td)[256] = tables.td;
+  const unsigned char *inv_sbox = tables.inv_sbox;
+
+  uint32_t s0 = load_be_(in) ^ rk[0];
+  uint32_t s1 = load_be_(in + 4) ^ rk[1];
+  uint32_t s2 = load_be_(in + 8) ^ rk[2];
+  uint32_t s3 = load_be_(in + 12) ^ rk[3];
+  for (int round = 1; round < 10; ++round) {
+    rk += 4;
+    const uint32_t t0 = td[0][s0 >> 24] ^ td[1][(s3 >> 16) & 0xff] ^
+        td[2][(s2 >> 8) & 0xff] ^ td[3][s1 & 0xff] ^ rk[0];
+    const uint32_t t1 = td[0][s1 >> 24] ^ td[1][(s0 >> 16) & 0xff] ^
+        td[2][(s3 >> 8) & 0xff] ^ td[3][s2 & 0xff] ^ rk[1];
+    const uint32_t t2 = td[0][s2 >> 24] ^ td[1][(s1 >> 16) & 0xff] ^
+        td[2][(s0 >> 8) & 0xff] ^ td[3][s3 & 0xff] ^ rk[2];
+    const uint32_t t3 = td[0][s3 >> 24] ^ td[1][(s2 >> 16) & 0xff] ^
+        td[2][(s1 >> 8) & 0xff] ^ td[3][s0 & 0xff] ^ rk[3];
+    s0 = t0;
+    s1 = t1;
+    s2 = t2;
+    s3 = t3;
+  }
+
+  // no InvMixColumns in the last round
+  rk += 4;
+  const uint32_t s[4] = {s0, s1, s2, s3};
+  for (int j = 0; j < 4; ++j) {
+    store_be_(out + 4 * j,
+              (((uint32_t)inv_sbox[s[j] >> 24] << 24) |
+               ((uint32_t)inv_sbox[(s[(j + 3) % 4] >> 16) & 0xff] << 16) |
+               ((uint32_t)inv_sbox[(s[(j + 2) % 4] >> 8) & 0xff] << 8) |
+               inv_sbox[s[(j + 1) % 4] & 0xff]) ^ rk[j]);
+  }
+}
+
+// Stores 'a' xored with 'b' at 'out', a block of each; 'out' may be
+// either input.
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("sse2")))
+static inline void xor_block_(unsigned char *out, const unsigned char *a, const unsigned char *b) {
+  _mm_storeu_si128((__m128i *)out, _mm_xor_si128(_mm_loadu_si128((const __m128i *)a),
+                                                 _mm_loadu_si128((const __m128i *)b)));
+}
+#else
+static inline void xor_block_(unsigned char *out, const unsigned char *a, const unsigned char *b) {
+  uint64_t x[2], y[2];
+  memcpy(x, a, AES_BLOCK_SIZE);
+  memcpy(y, b, AES_BLOCK_SIZE);
+  x[0] ^= y[0];
+  x[1] ^= y[1];
+  memcpy(out, x, AES_BLOCK_SIZE);
+}
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// The AES-NI kernels go through 8 blocks per iteration: each round
+// instruction has a latency of several cycles but a throughput of one
+// per cycle, so independent blocks keep the unit busy. The loops over
+// the 8 blocks must be unrolled for the blocks to stay in registers.
+
+__attribute__((target("aes")))
+static void encrypt_ecb_aesni_(const unsigned char *keys, unsigned char *out,
+                               const unsigned char *in, size_t blocks) {
+  __m128i rk[11];
+  for (int r = 0; r < 11; ++r)
+    rk[r] = _mm_load_si128((const __m128i *)(keys + 16 * r));
+
+  size_t b = 0;
+  for (; b + 8 <= blocks; b += 8) {
+    __m128i x[8];
+    #pragma GCC unroll 8
+    for (int i = 0; i < 8; ++i)
+      x[i] = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(in + 16 * (b + i))), rk[0]);
+    for (int r = 1; r < 10; ++r) {
+      #pragma GCC unroll 8
+      for (int i = 0; i < 8; ++i)
+        x[i] = _mm_aesenc_si128(x[i], rk[r]);
+    }
+    #pragma GCC unroll 8
+    for (int i = 0; i < 8; ++i)
+      _mm_storeu_si128((__m128i *)(out + 16 * (b + i)), _mm_aesenclast_si128(x[i], rk[10]));
+  }
+  for (; b < blocks; ++b) {
+    __m128i x = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(in + 16 * b)), rk[0]);
+    for (int r = 1; r < 10; ++r)
+      x = _mm_aesenc_si128(x, rk[r]);
+    _mm_storeu_si128((__m128i *)(out + 16 * b), _mm_aesenclast_si128(x, rk[10]));
+  }
+}
+
+__attribute__((target("aes")))
+static void decrypt_ecb_aesni_(const unsigned char *keys, unsigned char *out,
+                               const unsigned char *in, size_t blocks) {
+  __m128i rk[11];
+  for (int r = 0; r < 11; ++r)
+    rk[r] = _mm_load_si128((const __m128i *)(keys + 16 * r));
+
+  size_t b = 0;
+  for (; b + 8 <= blocks; b += 8) {
+    __m128i x[8];
+    #pragma GCC unroll 8
+    for (int i = 0; i < 8; ++i)
+      x[i] = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(in + 16 * (b + i))), rk[0]);
+    for (int r = 1; r < 10; ++r) {
+      #pragma GCC unroll 8
+      for (int i = 0; i < 8; ++i)
+        x[i] = _mm_aesdec_si128(x[i], rk[r]);
+    }
+    #pragma GCC unroll 8
+    for (int i = 0; i < 8; ++i)
+      _mm_storeu_si128((__m128i *)(out + 16 * (b + i)), _mm_aesdeclast_si128(x[i], rk[10]));
+  }
+  for (; b < blocks; ++b) {
+    __m128i x = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(in + 16 * b)), rk[0]);
+    for (int r = 1; r < 10; ++r)
+      x = _mm_aesdec_si128(x, rk[r]);
+    _mm_storeu_si128((__m128i *)(out + 16 * b), _mm_aesdeclast_si128(x, rk[10]));
+  }
+}
+
+// CBC encryption is one chain: the only work off its critical path is
+// xoring the next plaintext with the first round key, so each block
+// costs the latency of the rounds and one xor.
+__attribute__((target("aes")))
+static void encrypt_cbc_aesni_(const unsigned char *keys, unsigned char *out,
+                               const unsigned char *in, size_t blocks, unsigned char *iv) {
+  __m128i rk[11];
+  for (int r = 0; r < 11; ++r)
+    rk[r] = _mm_load_si128((const __m128i *)(keys + 16 * r));
+  __m128i chain = _mm_loadu_si128((const __m128i *)iv);
+
+  for (size_t b = 0; b < blocks; ++b) {
+    const __m128i p = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(in + 16 * b)), rk[0]);
+    chain = _mm_xor_si128(chain, p);
+    for (int r = 1; r < 10; ++r)
+      chain = _mm_aesenc_si128(chain, rk[r]);
+    chain = _mm_aesenclast_si128(chain, rk[10]);
+    _mm_storeu_si128((__m128i *)(out + 16 * b), chain);
+  }
+
+  _mm_storeu_si128((__m128i *)iv, chain);
+}
+
+// CBC decryption has no chain to wait for: each block only needs the
+// previous ciphertext, which is read before anything is stored.
+__attribute__((target("aes")))
+static void decrypt_cbc_aesni_(const unsigned char *keys, unsigned char *out,
+                               const unsigned char *in, size_t blocks, unsigned char *iv) {
+  __m128i rk[11];
+  for (int r = 0; r < 11; ++r)
+    rk[r] = _mm_load_si128((const __m128i *)(keys + 16 * r));
+  __m128i previous = _mm_loadu_si128((const __m128i *)iv);
+
+  size_t b = 0;
+  for (; b + 8 <= blocks; b += 8) {
+    __m128i c[8], x[8];
+    #pragma GCC unroll 8
+    for (int i = 0; i < 8; ++i) {
+      c[i] = _mm_loadu_si128((const __m128i *)(in + 16 * (b + i)));
+      x[i] = _mm_xor_si128(c[i], rk[0]);
+    }
+    for (int r = 1; r < 10; ++r) {
+      #pragma GCC unroll 8
+      for (int i = 0; i < 8; ++i)
+        x[i] = _mm_aesdec_si128(x[i], rk[r]);
+    }
+    #pragma GCC unroll 8
+    for (int i = 0; i < 8; ++i) {
+      x[i] = _mm_aesdeclast_si128(x[i], rk[10]);
+      _mm_storeu_si128((__m128i *)(out + 16 * (b + i)),
+                       _mm_xor_si128(x[i], i ? c[i - 1] : previous));
+    }
+    previous = c[7];
+  }
+  for (; b < blocks; ++b) {
+    const __m128i c = _mm_loadu_si128((const __m128i *)(in + 16 * b));
+    __m128i x = _mm_xor_si128(c, rk[0]);
+    for (int r = 1; r < 10; ++r)
+      x = _mm_aesdec_si128(x, rk[r]);
+    _mm_storeu_si128((__m128i *)(out + 16 * b),
+                     _mm_xor_si128(_mm_aesdeclast_si128(x, rk[10]), previous));
+    previous = c;
+  }
+
+  _mm_storeu_si128((__m128i *)iv, previous);
+}
+
+#endif
+
+void Aes128::encrypt_block(unsigned char *out, const unsigned char *in) const {
+  encrypt_ecb(out, in, 1);
+}
+
+void Aes128::decrypt_block(unsigned char *out, const unsigned char *in) const {
+  decrypt_ecb(out, in, 1);
+}
+
+void Aes128::encrypt_ecb(unsigned char *out, const unsigned char *in, size_t blocks) const {
+#if defined(__x86_64__) || defined(__i386__)
+  if (aesni_) {
+    encrypt_ecb_aesni_(enc_bytes_, out, in, blocks);
+    return;
+  }
+#endif
+
+  for (size_t b = 0; b < blocks; ++b)
+    encrypt_block_table_(enc_, out + AES_BLOCK_SIZE * b, in + AES_BLOCK_SIZE * b);
+}
+
+void Aes128::decrypt_ecb(unsigned char *out, const unsigned char *in, size_t blocks) const {
+#if defined(__x86_64__) || defined(__i386__)
+  if (aesni_) {
+    decrypt_ecb_aesni_(dec_bytes_, out, in, blocks);
+    return;
+  }
+#endif
+
+  for (size_t b = 0; b < blocks; ++b)
+    decrypt_block_table_(dec_, out + AES_BLOCK_SIZE * b, in + AES_BLOCK_SIZE * b);
+}
+
+void Aes128::encrypt_cbc(unsigned char *out, const unsigned char *in, size_t blocks,
+                         unsigned char *iv) const {
+#if defined(__x86_64__) || defined(__i386__)
+  if (aesni_) {
+    encrypt_cbc_aesni_(enc_bytes_, out, in, blocks, iv);
+    return;
+  }
+#endif
+
+  for (size_t b = 0; b < blocks; ++b) {
+    xor_block_(iv, iv, in + AES_BLOCK_SIZE * b);
+    encrypt_block_table_(enc_, iv, iv);
+    memcpy(out + AES_BLOCK_SIZE * b, iv, AES_BLOCK_SIZE);
+  }
+}
+
+void Aes128::decrypt_cbc(unsigned char *out, const unsigned char *in, size_t blocks,
+                         unsigned char *iv) const {
+#if defined(__x86_64__) || defined(__i386__)
+  if (aesni_) {
+    decrypt_cbc_aesni_(dec_bytes_, out, in, blocks, iv);
+    return;
+  }
+#endif
+
+  unsigned char ciphertext[AES_BLOCK_SIZE];
+  for (size_t b = 0; b < blocks; ++b) {
+    // keep the ciphertext, 'out' may overwrite it
+    memcpy(ciphertext, in + AES_BLOCK_SIZE * b, AES_BLOCK_SIZE);
+    decrypt_block_table_(dec_, out + AES_BLOCK_SIZE * b, ciphertext);
+    xor_block_(out + AES_BLOCK_SIZE * b, out + AES_BLOCK_SIZE * b, iv);
+    memcpy(iv, ciphertext, AES_BLOCK_SIZE);
+  }
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// bytes in an AES block, and in an AES-128 key
+static const size_t AES_BLOCK_SIZE = 16;
+static const size_t AES_KEY_SIZE = 16;
+
+// Implementations of AES-128 to pick from.
+enum AesBackend {
+  // portable, with 32-bit lookup tables
+  AES_BACKEND_TABLE = 0,
+  // the AES-NI instructions, 8 blocks at a time
+  AES_BACKEND_AESNI,
+  // OpenSSL's EVP layer (see AesEcb)
+  AES_BACKEND_OPENSSL,
+};
+
+// AES-NI when the cpu has it, OpenSSL otherwise. Setting
+// CRYPTOPALS_AES=table|aesni|openssl in the environment picks one,
+// which is handy to cross-check them; asking for AES-NI on a cpu
+// without it gets OpenSSL.
+AesBackend default_aes_backend();
+
+// Parses "table", "aesni" or "openssl". Returns 0 on success, -1 on
+// unknown names.
+int parse_aes_backend(const char *name, AesBackend *backend);
+
+// AES-128 with the key schedule expanded once, for both directions.
+// Works on whole blocks; 'out' may be 'in' everywhere.
+class Aes128 {
+ public:
+  // AES_BACKEND_OPENSSL is not handled here and gets the table
+  // implementation, as does AES-NI on a cpu without it.
+  explicit Aes128(const AesBackend backend = AES_BACKEND_AESNI);
+
+  // Expands the AES_KEY_SIZE bytes at 'key'.
+  void set_key(const unsigned char *key);
+
+  void encrypt_block(unsigned char *out, const unsigned char *in) const;
+  void decrypt_block(unsigned char *out, const unsigned char *in) const;
+
+  void encrypt_ecb(unsigned char *out, const unsigned char *in, size_t blocks) const;
+  void decrypt_ecb(unsigned char *out, const unsigned char *in, size_t blocks) const;
+  // Encrypts a CBC chain that follows the AES_BLOCK_SIZE bytes at
+  // 'iv' (the previous ciphertext block), and leaves there the last
+  // ciphertext block. Each block waits for the one before, so this
+  // goes one block at a time, keeping the chain in a register.
+  void encrypt_cbc(unsigned char *out, const unsigned char *in, size_t blocks,
+                   unsigned char *iv) const;
+  // Decrypts a CBC chain that follows the AES_BLOCK_SIZE bytes at
+  // 'iv' (the previous ciphertext block), and leaves there the last
+  // ciphertext block, so the next call can carry on.
+  void decrypt_cbc(unsigned char *out, const unsigned char *in, size_t blocks,
+                   unsigned char *iv) const;
+
+  bool aesni() const {
+    return aesni_;
+  }
+
+ private:
+  static const int ROUNDS_ = 10;
+
+  bool aesni_;
+  // round keys as big-endian words for the tables, and as bytes for
+  // AES-NI; decryption ones are for the equivalent inverse cipher
+  uint32_t enc_[4 * (ROUNDS_ + 1)];
+  uint32_t dec_[4 * (ROUNDS_ + 1)];
+  alignas(16) unsigned char enc_bytes_[AES_BLOCK_SIZE * (ROUNDS_ + 1)];
+  alignas(16) unsigned char dec_bytes_[AES_BLOCK_SIZE * (ROUNDS_ + 1)];
+};
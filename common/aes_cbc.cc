@@ -0,0 +1,89 @@
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "aes_cbc.h"
+#include "pkcs7.h"
+#include "thread_pool.h"
+
+// ranges handed to the workers: a few per thread, so that a slow one
+// does not hold up the others, but large enough to amortize the jobs
+static const size_t PARALLEL_RANGES_PER_THREAD_ = 4;
+static const size_t PARALLEL_MIN_RANGE_ = 256 * 1024;
+
+void aes_cbc_encrypt_blocks(const Aes128 &aes, const unsigned char *iv, unsigned char *out,
+                            const unsigned char *in, size_t size) {
+  unsigned char chain[AES_BLOCK_SIZE];
+  memcpy(chain, iv, AES_BLOCK_SIZE);
+  aes.encrypt_cbc(out, in, size / AES_BLOCK_SIZE, chain);
+}
+
+void aes_cbc_decrypt_blocks(const Aes128 &aes, const unsigned char *iv, unsigned char *out,
+                            const unsigned char *in, size_t size, ThreadPool *pool) {
+  if (!pool || size < AES_CBC_PARALLEL_MIN_SIZE) {
+    unsigned char chain[AES_BLOCK_SIZE];
+    memcpy(chain, iv, AES_BLOCK_SIZE);
+    aes.decrypt_cbc(out, in, size / AES_BLOCK_SIZE, chain);
+    return;
+  }
+
+  size_t range = size / (pool->threads_count() * PARALLEL_RANGES_PER_THREAD_);
+  if (range < PARALLEL_MIN_RANGE_)
+    range = PARALLEL_MIN_RANGE_;
+  range -= range % AES_BLOCK_SIZE;
+
+  // the block before each range, taken before any range is written,
+  // since 'out' may be 'in'
+  const size_t ranges = (size + range - 1) / range;
+  std::vector<unsigned char> chains(ranges * AES_BLOCK_SIZE);
+  memcpy(&chains[0], iv, AES_BLOCK_SIZE);
+  for (size_t r = 1; r < ranges; ++r)
+    memcpy(&chains[r * AES_BLOCK_SIZE], in + r * range - AES_BLOCK_SIZE, AES_BLOCK_SIZE);
+
+  for (size_t r = 0; r < ranges; ++r) {
+    const size_t start = r * range;
+    const size_t length = size - start < range ? size - start : range;
+    unsigned char *chain = &chains[r * AES_BLOCK_SIZE];
+    pool->submit([&aes, out, in, start, length, chain] {
+        aes.decrypt_cbc(out + start, in + start, length / AES_BLOCK_SIZE, chain);
+      });
+  }
+  pool->wait();
+}
+
+int aes_cbc_encrypt(const unsigned char *key, const unsigned char *iv,
+                    std::string_view plaintext, std::string *ciphertext) {
+  Aes128 aes(default_aes_backend());
+  aes.set_key(key);
+
+  ciphertext->reserve(plaintext.size() + AES_BLOCK_SIZE);
+  ciphertext->assign(plaintext);
+  if (pkcs7_pad(ciphertext, AES_BLOCK_SIZE) < 0)
+    return -1;
+
+  unsigned char *data = (unsigned char *)&(*ciphertext)[0];
+  aes_cbc_encrypt_blocks(aes, iv, data, data, ciphertext->size());
+  return 0;
+}
+
+int aes_cbc_decrypt(const unsigned char *key, const unsigned char *iv,
+                    std::string_view ciphertext, std::string *plaintext, ThreadPool *pool) {
+  if (ciphertext.empty() || ciphertext.size() % AES_BLOCK_SIZE) {
+    fprintf(stderr, "%s: size %ld is not a non-zero multiple of the block size\n",
+            __FUNCTION__, ciphertext.size());
+    return -1;
+  }
+
+  Aes128 aes(default_aes_backend());
+  aes.set_key(key);
+
+  plaintext->resize(ciphertext.size());
+  unsigned char *data = (unsigned char *)&(*plaintext)[0];
+  aes_cbc_decrypt_blocks(aes, iv, data, (const unsigned char *)ciphertext.data(),
+                         ciphertext.size(), pool);
+
+  if (pkcs7_unpad(plaintext, AES_BLOCK_SIZE) < 0) {
+    fprintf(stderr, "%s: bad padding\n", __FUNCTION__);
+    return -1;
+  }
+  return 0;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stddef.h>
+#include <string>
+#include <string_view>
+#include "aes.h"
+
+class ThreadPool;
+
+// AES-128-CBC with PKCS#7 padding, on Aes128 (its default backend,
+// see default_aes_backend()). 'key' and 'iv' are AES_KEY_SIZE and
+// AES_BLOCK_SIZE bytes. The first two return 0 on success, or -1
+// after reporting the error; bad padding is reported too.
+
+// Encryption is serial: the plaintext is copied once into
+// 'ciphertext', padded in place and encrypted there.
+int aes_cbc_encrypt(const unsigned char *key, const unsigned char *iv,
+                    std::string_view plaintext, std::string *ciphertext);
+
+// ciphertexts at least this large are split across the pool given to
+// decryption; smaller ones are decrypted on the calling thread
+static const size_t AES_CBC_PARALLEL_MIN_SIZE = 1 << 20;
+
+// Decryption has no chain: every plaintext block only needs two
+// ciphertext blocks, so large inputs are split in ranges decrypted on
+// 'pool', if not NULL, each range starting from the ciphertext block
+// before it. Within a range, blocks go 8 at a time through AES-NI.
+int aes_cbc_decrypt(const unsigned char *key, const unsigned char *iv,
+                    std::string_view ciphertext, std::string *plaintext,
+                    ThreadPool *pool = NULL);
+
+// The unpadded cores of the two above, on 'size' bytes, a multiple of
+// AES_BLOCK_SIZE, from 'in' to 'out' (which may be the same).
+void aes_cbc_encrypt_blocks(const Aes128 &aes, const unsigned char *iv, unsigned char *out,
+                            const unsigned char *in, size_t size);
+void aes_cbc_decrypt_blocks(const Aes128 &aes, const unsigned char *iv, unsigned char *out,
+                            const unsigned char *in, size_t size, ThreadPool *pool);
@@ -0,0 +1,177 @@
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include "aes_ecb.h"
+#include "thread_pool.h"
+
+static void report_openssl_error_(const char *function) {
+  fprintf(stderr, "%s: OpenSSL error\n", function);
+  ERR_print_errors_fp(stderr);
+}
+
+AesEcb::AesEcb(const AesBackend backend)
+    : backend_(backend), aes_(backend),
+      ctx_(backend == AES_BACKEND_OPENSSL ? EVP_CIPHER_CTX_new() : NULL),
+      encrypt_(false), ready_(false), pending_(0) {
+  // the cipher only needs setting once: after that, init() rekeys the
+  // context in place
+  if (ctx_ && !EVP_CipherInit_ex(ctx_, EVP_aes_128_ecb(), NULL, NULL, NULL, 0))
+    report_openssl_error_(__FUNCTION__);
+}
+
+AesEcb::~AesEcb() {
+  EVP_CIPHER_CTX_free(ctx_);
+}
+
+int AesEcb::init(const unsigned char *key, const bool encrypt) {
+  ready_ = false;
+  pending_ = 0;
+
+  if (backend_ != AES_BACKEND_OPENSSL) {
+    aes_.set_key(key);
+  } else {
+    if (!ctx_) {
+      fprintf(stderr, "%s: no cipher context\n", __FUNCTION__);
+      return -1;
+    }
+
+    if (!EVP_CipherInit_ex(ctx_, NULL, NULL, key, NULL, encrypt)) {
+      report_openssl_error_(__FUNCTION__);
+      return -1;
+    }
+    EVP_CIPHER_CTX_set_padding(ctx_, 0);
+  }
+
+  encrypt_ = encrypt;
+  ready_ = true;
+  return 0;
+}
+
+// Whole blocks only.
+int AesEcb::process_(unsigned char *out, const unsigned char *in, size_t size) {
+  if (backend_ != AES_BACKEND_OPENSSL) {
+    if (encrypt_)
+      aes_.encrypt_ecb(out, in, size / AES_BLOCK_SIZE);
+    else
+      aes_.decrypt_ecb(out, in, size / AES_BLOCK_SIZE);
+    return 0;
+  }
+
+  // in chunks that fit an int; without padding, whole blocks go
+  // straight through
+  while (size) {
+    const size_t chunk = size < (1 << 30) ? size : (1 << 30);
+    int outlen;
+    if (!EVP_CipherUpdate(ctx_, out, &outlen, in, chunk)) {
+      report_openssl_error_(__FUNCTION__);
+      return -1;
+    }
+    in += chunk;
+    out += chunk;
+    size -= chunk;
+  }
+  return 0;
+}
+
+int AesEcb::update(const unsigned char *data, size_t size, const Sink &sink) {
+  if (!ready_) {
+    fprintf(stderr, "%s: no key set\n", __FUNCTION__);
+    return -1;
+  }
+
+  if (pending_) {
+    // complete the block left over by the previous chunk
+    const size_t missing = AES_BLOCK_SIZE - pending_;
+    const size_t taken = size < missing ? size : missing;
+    memcpy(partial_ + pending_, data, taken);
+    pending_ += taken;
+    data += taken;
+    size -= taken;
+    if (pending_ < AES_BLOCK_SIZE)
+      return 0;
+
+    if (process_(out_, partial_, AES_BLOCK_SIZE) < 0)
+      return -1;
+    sink(out_, AES_BLOCK_SIZE);
+    pending_ = 0;
+  }
+
+  while (size >= AES_BLOCK_SIZE) {
+    size_t chunk = size < CHUNK_SIZE_ ? size : CHUNK_SIZE_;
+    chunk -= chunk % AES_BLOCK_SIZE;
+    if (process_(out_, data, chunk) < 0)
+      return -1;
+    sink(out_, chunk);
+
+    data += chunk;
+    size -= chunk;
+  }
+
+  memcpy(partial_, data, size);
+  pending_ = size;
+  return 0;
+}
+
+int AesEcb::finish() {
+  if (pending_) {
+    fprintf(stderr, "%s: %ld trailing bytes do not make a whole block\n",
+            __FUNCTION__, pending_);
+    pending_ = 0;
+    return -1;
+  }
+
+  return 0;
+}
+
+int AesEcb::process(unsigned char *out, const unsigned char *in, size_t size) {
+  if (!ready_) {
+    fprintf(stderr, "%s: no key set\n", __FUNCTION__);
+    return -1;
+  }
+  if (size % AES_BLOCK_SIZE) {
+    fprintf(stderr, "%s: size %ld is not a multiple of the block size\n",
+            __FUNCTION__, size);
+    return -1;
+  }
+
+  return process_(out, in, size);
+}
+
+AesEcb &thread_aes_ecb() {
+  static thread_local AesEcb engine;
+  return engine;
+}
+
+// ranges handed to the workers: a few per thread, so that a slow one
+// does not hold up the others, but large enough to amortize the jobs
+static const size_t PARALLEL_RANGES_PER_THREAD_ = 4;
+static const size_t PARALLEL_MIN_RANGE_ = 256 * 1024;
+
+int aes_ecb_parallel(const unsigned char *key, const bool encrypt, unsigned char *out,
+                     const unsigned char *in, size_t size, ThreadPool *pool) {
+  if (size % AES_BLOCK_SIZE) {
+    fprintf(stderr, "%s: size %ld is not a multiple of the block size\n",
+            __FUNCTION__, size);
+    return -1;
+  }
+
+  size_t range = size / (pool->threads_count() * PARALLEL_RANGES_PER_THREAD_);
+  if (range < PARALLEL_MIN_RANGE_)
+    range = PARALLEL_MIN_RANGE_;
+  range -= range % AES_BLOCK_SIZE;
+
+  std::atomic<bool> failed(false);
+  for (size_t start = 0; start < size; start += range) {
+    const size_t length = size - start < range ? size - start : range;
+    pool->submit([key, encrypt, out, in, start, length, &failed] {
+        AesEcb &aes = thread_aes_ecb();
+        if (aes.init(key, encrypt) < 0 || aes.process(out + start, in + start, length) < 0)
+          failed = true;
+      });
+  }
+  pool->wait();
+
+  return failed ? -1 : 0;
+}
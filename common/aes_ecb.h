@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stddef.h>
+#include <functional>
+#include "aes.h"
+
+typedef struct evp_cipher_ctx_st EVP_CIPHER_CTX;
+
+// AES-128-ECB without padding, through Aes128 or OpenSSL's EVP layer.
+// The key schedule or cipher context is allocated once and kept
+// across keys and messages; it is not thread safe, so each thread
+// should use its own engine (see thread_aes_ecb()).
+//
+// update() takes the input in chunks of any size and passes whole
+// blocks to the sink as soon as they are ready, through a buffer of
+// bounded size; finish() checks that no partial block is left over.
+// All return 0 on success, or -1 after reporting the error.
+class AesEcb {
+ public:
+  typedef std::function<void(const unsigned char *data, size_t size)> Sink;
+
+  explicit AesEcb(const AesBackend backend = default_aes_backend());
+  ~AesEcb();
+
+  AesEcb(const AesEcb &) = delete;
+  AesEcb &operator=(const AesEcb &) = delete;
+
+  // Starts a new message with the AES_KEY_SIZE bytes at 'key'.
+  int init(const unsigned char *key, const bool encrypt);
+
+  int update(const unsigned char *data, size_t size, const Sink &sink);
+  int finish();
+
+  // Processes a whole message of 'size' bytes, a multiple of
+  // AES_BLOCK_SIZE, from 'in' to 'out' (which may be the same) with
+  // the current key.
+  int process(unsigned char *out, const unsigned char *in, size_t size);
+
+  AesBackend backend() const {
+    return backend_;
+  }
+
+ private:
+  static const size_t CHUNK_SIZE_ = 64 * 1024;
+
+  int process_(unsigned char *out, const unsigned char *in, size_t size);
+
+  AesBackend backend_;
+  // one or the other, depending on the backend
+  Aes128 aes_;
+  EVP_CIPHER_CTX *ctx_;
+  bool encrypt_;
+  // whether a key was set
+  bool ready_;
+  // bytes of the current message waiting for the rest of their block
+  unsigned char partial_[AES_BLOCK_SIZE];
+  size_t pending_;
+  unsigned char out_[CHUNK_SIZE_];
+};
+
+// The engine of the calling thread, created on first use.
+AesEcb &thread_aes_ecb();
+
+class ThreadPool;
+
+// Processes 'size' bytes, a multiple of AES_BLOCK_SIZE, from 'in' to
+// 'out' (which may be the same) with 'key', splitting them in
+// block-aligned ranges run on 'pool'; each worker uses its own engine
+// and writes its range in place, so the result is the one of a single
+// engine. Returns 0 on success, or -1 after reporting the error.
+int aes_ecb_parallel(const unsigned char *key, const bool encrypt, unsigned char *out,
+                     const unsigned char *in, size_t size, ThreadPool *pool);
@@ -0,0 +1,65 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <openssl/rand.h>
+#include "aes_oracle.h"
+#include "pkcs7.h"
+
+AesOracle::AesOracle(const CipherMode mode, std::string_view suffix, const bool random_padding,
+                     const size_t max_batch)
+    : mode_(mode), suffix_(suffix), random_padding_(random_padding),
+      max_batch_(max_batch ? max_batch : 1), aes_(default_aes_backend()) {
+  unsigned char key[AES_KEY_SIZE];
+  if (RAND_bytes(key, sizeof(key)) != 1) {
+    fprintf(stderr, "%s: cannot get a random key\n", __FUNCTION__);
+    exit(1);
+  }
+  aes_.set_key(key);
+}
+
+int AesOracle::append_random_padding_(std::string *s) {
+  unsigned char random[1 + MAX_RANDOM_PADDING_];
+  if (RAND_bytes(random, sizeof(random)) != 1) {
+    fprintf(stderr, "%s: cannot get random bytes\n", __FUNCTION__);
+    return -1;
+  }
+
+  const size_t count =
+      MIN_RANDOM_PADDING_ + random[0] % (MAX_RANDOM_PADDING_ - MIN_RANDOM_PADDING_ + 1);
+  s->append((const char *)random + 1, count);
+  return 0;
+}
+
+int AesOracle::encrypt_(const std::vector<std::string_view> &plaintexts,
+                        std::vector<std::string> *ciphertexts) {
+  for (size_t i = 0; i < plaintexts.size(); ++i) {
+    message_.clear();
+    if (random_padding_ && append_random_padding_(&message_) < 0)
+      return -1;
+    message_.append(plaintexts[i]);
+    message_.append(suffix_);
+    if (random_padding_ && append_random_padding_(&message_) < 0)
+      return -1;
+
+    pkcs7_pad(&message_, AES_BLOCK_SIZE);
+
+    std::string &ciphertext = (*ciphertexts)[i];
+    ciphertext.resize(message_.size());
+    unsigned char *out = (unsigned char *)&ciphertext[0];
+    const unsigned char *in = (const unsigned char *)message_.data();
+    const size_t blocks = message_.size() / AES_BLOCK_SIZE;
+
+    if (mode_ == CIPHER_MODE_ECB) {
+      aes_.encrypt_ecb(out, in, blocks);
+      continue;
+    }
+
+    unsigned char iv[AES_BLOCK_SIZE];
+    if (RAND_bytes(iv, sizeof(iv)) != 1) {
+      fprintf(stderr, "%s: cannot get a random IV\n", __FUNCTION__);
+      return -1;
+    }
+    aes_.encrypt_cbc(out, in, blocks, iv);
+  }
+
+  return 0;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stddef.h>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "aes.h"
+#include "oracle.h"
+
+// Block cipher modes the oracles may use.
+enum CipherMode {
+  CIPHER_MODE_ECB = 0,
+  CIPHER_MODE_CBC,
+};
+
+// An in-process stand-in for a remote oracle: AES-128 with a random
+// key, over each plaintext followed by 'suffix', padded with PKCS#7.
+// CBC starts every message from a fresh random IV, which is not part
+// of the ciphertext.
+//
+// With 'random_padding', 5 to 10 random bytes also go on either side
+// of the message, anew on every encryption.
+class AesOracle : public Oracle {
+ public:
+  AesOracle(const CipherMode mode, std::string_view suffix, const bool random_padding = false,
+            const size_t max_batch = 1);
+
+  size_t max_batch() const override {
+    return max_batch_;
+  }
+
+  CipherMode mode() const {
+    return mode_;
+  }
+
+ protected:
+  int encrypt_(const std::vector<std::string_view> &plaintexts,
+               std::vector<std::string> *ciphertexts) override;
+
+ private:
+  static const size_t MIN_RANDOM_PADDING_ = 5;
+  static const size_t MAX_RANDOM_PADDING_ = 10;
+
+  // Appends 5 to 10 random bytes to 's'.
+  int append_random_padding_(std::string *s);
+
+  CipherMode mode_;
+  std::string suffix_;
+  bool random_padding_;
+  size_t max_batch_;
+  Aes128 aes_;
+  // the message being encrypted, reused across calls
+  std::string message_;
+};
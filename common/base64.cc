@@ -0,0 +1,378 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#include "cpu.h"
+#include "input.h"
+#include "base64.h"
+
+// marks chars outside of the base64 alphabet in the decode table
+static const unsigned char BASE64_BAD_ = 0xff;
+
+struct Base64DecodeTable_ {
+  Base64DecodeTable_() {
+    memset(value, BASE64_BAD_, sizeof(value));
+    for (int i = 0; i < 26; ++i) {
+      value['A' + i] = i;
+      value['a' + i] = i + 26;
+    }
+    for (int i = 0; i < 10; ++i)
+      value['0' + i] = i + 52;
+    value['+'] = 62;
+    value['/'] = 63;
+  }
+
+  unsigned char value[256];
+};
+static const Base64DecodeTable_ base64_table_;
+
+// Decodes whole quads from 'in' until it finds one holding something
+// other than alphabet chars; returns the number of chars decoded.
+static size_t base64_decode_scalar_(unsigned char *out, const char *in, size_t size) {
+  const unsigned char *table = base64_table_.value;
+
+  size_t i = 0;
+  for (; i + 4 <= size; i += 4) {
+    const uint32_t a = table[(unsigned char)in[i]];
+    const uint32_t b = table[(unsigned char)in[i + 1]];
+    const uint32_t c = table[(unsigned char)in[i + 2]];
+    const uint32_t d = table[(unsigned char)in[i + 3]];
+    if ((a | b | c | d) == BASE64_BAD_)
+      break;
+
+    const uint32_t v = (a << 18) | (b << 12) | (c << 6) | d;
+    out[0] = v >> 16;
+    out[1] = v >> 8;
+    out[2] = v;
+    out += 3;
+  }
+  return i;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// Same contract as base64_decode_scalar_(), but 32 chars at a time
+// (W. Mula's nibble lookup validation and multiply-add packing). Each
+// iteration stores 32 bytes, of which only the first 24 are decoded
+// output, so 'out' must have 8 bytes to spare.
+__attribute__((target("avx2")))
+static size_t base64_decode_avx2_(unsigned char *out, const char *in, size_t size) {
+  // bit sets indexed by low and high nibble; a char is valid when
+  // the two sets do not intersect
+  const __m256i lut_lo = _mm256_setr_epi8(
+      0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+      0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a,
+      0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+      0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+  const __m256i lut_hi = _mm256_setr_epi8(
+      0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+      0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+      0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+      0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+  // offset from char to sextet, indexed by high nibble ('/' gets its own)
+  const __m256i lut_roll = _mm256_setr_epi8(
+      0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+      0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+  const __m256i mask_2f = _mm256_set1_epi8(0x2f);
+  const __m256i pack_shuffle = _mm256_setr_epi8(
+      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+  const __m256i pack_permute = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, -1, -1);
+
+  size_t i = 0;
+  for (; i + 32 <= size; i += 32) {
+    const __m256i str = _mm256_loadu_si256((const __m256i *)(in + i));
+
+    const __m256i hi_nibbles = _mm256_and_si256(_mm256_srli_epi32(str, 4), mask_2f);
+    const __m256i lo_nibbles = _mm256_and_si256(str, mask_2f);
+    const __m256i hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+    const __m256i lo = _mm256_shuffle_epi8(lut_lo, lo_nibbles);
+    if (!_mm256_testz_si256(lo, hi))
+      // leave this block to the scalar code
+      break;
+
+    const __m256i eq_2f = _mm256_cmpeq_epi8(str, mask_2f);
+    const __m256i roll = _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(eq_2f, hi_nibbles));
+    const __m256i sextets = _mm256_add_epi8(str, roll);
+
+    // 4 x 6 bits -> 3 bytes in each 32-bit lane, then squeeze the lanes
+    const __m256i pairs = _mm256_maddubs_epi16(sextets, _mm256_set1_epi32(0x01400140));
+    const __m256i triples = _mm256_madd_epi16(pairs, _mm256_set1_epi32(0x00011000));
+    const __m256i packed = _mm256_permutevar8x32_epi32(
+        _mm256_shuffle_epi8(triples, pack_shuffle), pack_permute);
+    _mm256_storeu_si256((__m256i *)(out + i / 4 * 3), packed);
+  }
+  return i;
+}
+
+// Encodes 24 bytes into 32 chars per iteration, 12 bytes per 128-bit
+// lane; each lane is loaded 16 bytes wide, so 'in' must have 4 more
+// readable bytes past the last block.
+__attribute__((target("avx2")))
+static size_t base64_encode_avx2_(char *out, const unsigned char *in, size_t size) {
+  // spread each 3-byte group over a 32-bit lane as [b1 b0 b2 b1]
+  const __m256i spread = _mm256_setr_epi8(
+      1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+      1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+  // offset from sextet to char, indexed by the sextet range (see below)
+  const __m256i lut = _mm256_setr_epi8(
+      'A', 'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 0, 0,
+      'A', 'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 0, 0);
+
+  size_t i = 0;
+  for (; i + 28 <= size; i += 24) {
+    const __m256i bytes = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)(in + i))),
+        _mm_loadu_si128((const __m128i *)(in + i + 12)), 1);
+    const __m256i groups = _mm256_shuffle_epi8(bytes, spread);
+
+    // move the 4 sextets of each group to the low bits of its 4 bytes
+    const __m256i ac = _mm256_mulhi_epu16(_mm256_and_si256(groups, _mm256_set1_epi32(0x0fc0fc00)),
+                                          _mm256_set1_epi32(0x04000040));
+    const __m256i bd = _mm256_mullo_epi16(_mm256_and_si256(groups, _mm256_set1_epi32(0x003f03f0)),
+                                          _mm256_set1_epi32(0x01000010));
+    const __m256i sextets = _mm256_or_si256(ac, bd);
+
+    // range index: 0 for 0-25, 1 for 26-51, then 2-11 for the digits
+    // and 12/13 for '+' and '/'
+    __m256i range = _mm256_subs_epu8(sextets, _mm256_set1_epi8(51));
+    range = _mm256_sub_epi8(range, _mm256_cmpgt_epi8(sextets, _mm256_set1_epi8(25)));
+    const __m256i chars = _mm256_add_epi8(sextets, _mm256_shuffle_epi8(lut, range));
+    _mm256_storeu_si256((__m256i *)(out + i / 3 * 4), chars);
+  }
+  return i;
+}
+
+#endif
+
+static size_t base64_encode_scalar_(char *out, const unsigned char *in, size_t size) {
+  static const char alphabet[] =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+  const char *start = out;
+  size_t i = 0;
+  for (; i + 3 <= size; i += 3) {
+    const uint32_t v = (in[i] << 16) | (in[i + 1] << 8) | in[i + 2];
+    out[0] = alphabet[v >> 18];
+    out[1] = alphabet[(v >> 12) & 0x3f];
+    out[2] = alphabet[(v >> 6) & 0x3f];
+    out[3] = alphabet[v & 0x3f];
+    out += 4;
+  }
+
+  // pad the last quad
+  if (i < size) {
+    const uint32_t v = (in[i] << 16) | (i + 1 < size ? in[i + 1] << 8 : 0);
+    out[0] = alphabet[v >> 18];
+    out[1] = alphabet[(v >> 12) & 0x3f];
+    out[2] = i + 1 < size ? alphabet[(v >> 6) & 0x3f] : '=';
+    out[3] = '=';
+    out += 4;
+  }
+
+  return out - start;
+}
+
+size_t base64_encode(char *out, const unsigned char *in, size_t size) {
+  size_t done = 0;
+#if defined(__x86_64__) || defined(__i386__)
+  if (simd_level() >= SIMD_AVX2)
+    done = base64_encode_avx2_(out, in, size);
+#endif
+  return done / 3 * 4 + base64_encode_scalar_(out + done / 3 * 4, in + done, size - done);
+}
+
+void encodebase64(std::string *encoded, std::string_view s) {
+  encoded->resize(base64_encoded_size(s.size()));
+  base64_encode(&(*encoded)[0], (const unsigned char *)s.data(), s.size());
+}
+
+static size_t base64_decode_quads_(unsigned char *out, const char *in, size_t size) {
+  size_t done = 0;
+#if defined(__x86_64__) || defined(__i386__)
+  if (simd_level() >= SIMD_AVX2)
+    done = base64_decode_avx2_(out, in, size);
+#endif
+  return done + base64_decode_scalar_(out + done / 4 * 3, in + done, size - done);
+}
+
+// Decodes a quad the bulk decoders stopped on, which is fine only if
+// it is the final one and carries padding. Returns the number of bytes
+// produced, or -1 with the index of the offending char in '*bad'.
+static int base64_decode_last_quad_(unsigned char out[3], const char in[4],
+                                    const bool padding_ok, int *bad) {
+  int pads = 0;
+  if (padding_ok && in[3] == '=')
+    pads = in[2] == '=' ? 2 : 1;
+
+  uint32_t v = 0;
+  for (int i = 0; i < 4; ++i) {
+    uint32_t d = 0;
+    if (i < 4 - pads) {
+      d = base64_table_.value[(unsigned char)in[i]];
+      if (d == BASE64_BAD_) {
+        *bad = i;
+        return -1;
+      }
+    }
+    v = (v << 6) | d;
+  }
+
+  out[0] = v >> 16;
+  out[1] = v >> 8;
+  out[2] = v;
+  return 3 - pads;
+}
+
+Base64Decoder::Base64Decoder(const Sink &sink)
+    : sink_(sink), failed_(false), consumed_(0), staged_(0), runs_count_(0) {}
+
+int Base64Decoder::feed(std::string_view input) {
+  if (failed_)
+    return -1;
+
+  const char *data = input.data();
+  const size_t size = input.size();
+  size_t cursor = 0;
+  while (cursor < size) {
+    // copy the run up to the next newline, or until the stage is full
+    size_t run = size - cursor;
+    if (run > STAGE_SIZE_ - staged_)
+      run = STAGE_SIZE_ - staged_;
+    const char *newline = (const char *)memchr(data + cursor, '\n', run);
+    if (newline)
+      run = newline - (data + cursor);
+
+    if (run) {
+      runs_[runs_count_].index = staged_;
+      runs_[runs_count_].offset = consumed_ + cursor;
+      ++runs_count_;
+      memcpy(stage_ + staged_, data + cursor, run);
+      staged_ += run;
+      cursor += run;
+    }
+    if (newline)
+      // silently discard this char
+      ++cursor;
+
+    if (staged_ == STAGE_SIZE_ || runs_count_ == MAX_RUNS_) {
+      if (flush_(false) < 0)
+        return -1;
+    }
+  }
+
+  consumed_ += size;
+  return 0;
+}
+
+int Base64Decoder::finish() {
+  if (failed_)
+    return -1;
+
+  int result = 0;
+  if (staged_)
+    result = flush_(true);
+
+  // ready for another stream
+  consumed_ = 0;
+  staged_ = 0;
+  runs_count_ = 0;
+  return result;
+}
+
+// Decodes the whole quads in the stage and keeps the leftovers for
+// later. A padded quad can only be the last one, so unless 'final' is
+// set it stays in the stage until we know whether anything follows.
+int Base64Decoder::flush_(const bool final) {
+  const size_t whole = staged_ / 4 * 4;
+  if (final && whole != staged_) {
+    fprintf(stderr, "%s: we needed data at offset [%ld], but no more data available\n",
+            __FUNCTION__, input_offset_(staged_ - 1) + 1);
+    failed_ = true;
+    return -1;
+  }
+
+  const size_t done = base64_decode_quads_(out_, stage_, whole);
+  size_t produced = done / 4 * 3;
+  size_t keep_from = whole;
+
+  if (done != whole) {
+    int bad;
+    const bool maybe_last = done + 4 == staged_;
+    int padded = base64_decode_last_quad_(out_ + produced, stage_ + done,
+                                          maybe_last, &bad);
+    if (padded < 0) {
+      const unsigned char c = stage_[done + bad];
+      fprintf(stderr, "%s: bad char [%c](%d) at offset [%ld] while decoding\n",
+              __FUNCTION__, c, c, input_offset_(done + bad));
+      failed_ = true;
+      return -1;
+    }
+
+    if (final)
+      produced += padded;
+    else
+      keep_from = done;
+  }
+
+  if (produced)
+    sink_(out_, produced);
+
+  // move the leftovers, and the runs they belong to, to the front
+  size_t first_run = 0;
+  while (first_run + 1 < runs_count_ && runs_[first_run + 1].index <= keep_from)
+    ++first_run;
+
+  size_t kept_runs = 0;
+  if (keep_from < staged_) {
+    runs_[0].offset = runs_[first_run].offset + (keep_from - runs_[first_run].index);
+    runs_[0].index = 0;
+    kept_runs = 1;
+    for (size_t r = first_run + 1; r < runs_count_; ++r) {
+      runs_[kept_runs].index = runs_[r].index - keep_from;
+      runs_[kept_runs].offset = runs_[r].offset;
+      ++kept_runs;
+    }
+    memmove(stage_, stage_ + keep_from, staged_ - keep_from);
+  }
+  staged_ -= keep_from;
+  runs_count_ = kept_runs;
+
+  return 0;
+}
+
+// Maps the index of a staged char back to its offset in the input.
+size_t Base64Decoder::input_offset_(const size_t index) const {
+  size_t r = runs_count_ - 1;
+  while (runs_[r].index > index)
+    --r;
+  return runs_[r].offset + (index - runs_[r].index);
+}
+
+int decodebase64(std::string *decoded, std::string_view s) {
+  // reserve some space for the result (the output can only be shorter)
+  decoded->reserve(decoded->size() + s.size() / 4 * 3);
+
+  Base64Decoder decoder([decoded](const unsigned char *data, size_t size) {
+      decoded->append((const char *)data, size);
+    });
+  if (decoder.feed(s) < 0)
+    return -1;
+  return decoder.finish();
+}
+
+int decodebase64_fd(int fd, const Base64Decoder::Sink &sink) {
+  Base64Decoder decoder(sink);
+
+  int result = read_input_chunks(fd, [&decoder](std::string_view chunk) {
+      return decoder.feed(chunk);
+    });
+  if (result < 0)
+    return -1;
+
+  return decoder.finish();
+}
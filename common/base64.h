@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stddef.h>
+#include <functional>
+#include <string>
+#include <string_view>
+
+// Incremental base64 decoder working in bounded memory: feed() takes
+// the text in chunks of any size (quads and newlines can be split at
+// any point) and passes decoded bytes to the sink as they become
+// available; finish() decodes what is left. Both return 0 on success,
+// or -1 on a bad char, bad padding or a truncated final quad (the
+// offset of the problem is reported on stderr).
+class Base64Decoder {
+ public:
+  typedef std::function<void(const unsigned char *data, size_t size)> Sink;
+
+  explicit Base64Decoder(const Sink &sink);
+
+  int feed(std::string_view data);
+  int finish();
+
+ private:
+  static const size_t STAGE_SIZE_ = 4096;
+  static const size_t MAX_RUNS_ = 256;
+
+  // where a run of newline-free chars landed in the stage, and where
+  // it came from in the input
+  struct Run {
+    size_t index;
+    size_t offset;
+  };
+
+  int flush_(const bool final);
+  size_t input_offset_(const size_t index) const;
+
+  Sink sink_;
+  bool failed_;
+  // number of chars fed so far
+  size_t consumed_;
+  // newline-free chars waiting to be decoded in bulk
+  char stage_[STAGE_SIZE_];
+  size_t staged_;
+  Run runs_[MAX_RUNS_];
+  size_t runs_count_;
+  // the avx2 kernel stores 8 bytes past the decoded output
+  unsigned char out_[STAGE_SIZE_ / 4 * 3 + 8];
+};
+
+// Number of chars base64_encode() produces for 'size' bytes.
+inline size_t base64_encoded_size(const size_t size) {
+  return (size + 2) / 3 * 4;
+}
+
+// Encodes 'size' bytes from 'in' as base64 at 'out', padding the last
+// quad with '=' as needed; returns the number of chars written.
+size_t base64_encode(char *out, const unsigned char *in, size_t size);
+
+void encodebase64(std::string *encoded, std::string_view s);
+
+// Decodes base64 text, silently skipping newlines.
+int decodebase64(std::string *decoded, std::string_view s);
+
+// Streams the whole of 'fd' through a Base64Decoder, see
+// read_input_chunks().
+int decodebase64_fd(int fd, const Base64Decoder::Sink &sink);
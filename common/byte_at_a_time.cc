@@ -0,0 +1,109 @@
+#include <stdio.h>
+#include <string.h>
+#include <string_view>
+#include <vector>
+#include "aes.h"
+#include "byte_at_a_time.h"
+#include "ecb_detect.h"
+#include "oracle_detect.h"
+
+// one block for each value of the byte
+static const size_t DICTIONARY_SIZE_ = 256 * AES_BLOCK_SIZE;
+// guesses at a byte, likeliest first, for the probes sent ahead of it
+static const char SPECULATION_ORDER_[] =
+    " etaoinshrdlu\ncmwfygpbvk,.'TAISHWMBCDxjqzN-?!";
+
+// Fills 'plaintext' with the probe for the byte of the secret after
+// 'known'.
+static void build_probe_(std::string_view known, std::string *plaintext) {
+  const size_t i = known.size();
+
+  // the 15 bytes before byte i, or filler before the secret starts
+  unsigned char block[AES_BLOCK_SIZE];
+  const size_t tail = i < AES_BLOCK_SIZE - 1 ? i : AES_BLOCK_SIZE - 1;
+  memset(block, 'A', AES_BLOCK_SIZE - 1 - tail);
+  memcpy(block + AES_BLOCK_SIZE - 1 - tail, known.data() + i - tail, tail);
+
+  const size_t filler = AES_BLOCK_SIZE - 1 - i % AES_BLOCK_SIZE;
+  plaintext->resize(DICTIONARY_SIZE_ + filler);
+  unsigned char *out = (unsigned char *)&(*plaintext)[0];
+  for (int value = 0; value < 256; ++value) {
+    block[AES_BLOCK_SIZE - 1] = value;
+    memcpy(out + AES_BLOCK_SIZE * value, block, AES_BLOCK_SIZE);
+  }
+  memset(out + DICTIONARY_SIZE_, 'A', filler);
+}
+
+// Finds byte 'i' of the secret in the ciphertext of its probe.
+// Returns its value, or -1 if no dictionary block matches.
+static int match_probe_(std::string_view ciphertext, const size_t i, BlockIndex *index) {
+  const size_t target = DICTIONARY_SIZE_ + i / AES_BLOCK_SIZE * AES_BLOCK_SIZE;
+  if (ciphertext.size() < target + AES_BLOCK_SIZE)
+    return -1;
+
+  const unsigned char *data = (const unsigned char *)ciphertext.data();
+  index->reset(data, 256);
+  for (size_t value = 0; value < 256; ++value)
+    index->insert(value);
+
+  const size_t found = index->find(data + target);
+  return found == BlockIndex::NOT_FOUND ? -1 : (int)found;
+}
+
+int recover_ecb_suffix(Oracle *oracle, std::string *secret) {
+  OracleProfile profile;
+  if (profile_oracle(oracle, &profile) < 0)
+    return -1;
+  if (!profile.ecb_ || profile.block_size_ != AES_BLOCK_SIZE) {
+    fprintf(stderr, "%s: need ECB with %ld-byte blocks, found %s with %ld-byte blocks\n",
+            __FUNCTION__, AES_BLOCK_SIZE, profile.ecb_ ? "ECB" : "another mode",
+            profile.block_size_);
+    return -1;
+  }
+
+  size_t guesses = oracle->max_batch() - 1;
+  if (guesses > sizeof(SPECULATION_ORDER_) - 1)
+    guesses = sizeof(SPECULATION_ORDER_) - 1;
+
+  std::vector<std::string> probes(1 + guesses);
+  std::vector<std::string_view> plaintexts;
+  std::vector<std::string> ciphertexts;
+  BlockIndex index;
+  secret->clear();
+  while (true) {
+    build_probe_(*secret, &probes[0]);
+    for (size_t g = 0; g < guesses; ++g) {
+      secret->push_back(SPECULATION_ORDER_[g]);
+      build_probe_(*secret, &probes[1 + g]);
+      secret->pop_back();
+    }
+
+    plaintexts.assign(probes.begin(), probes.end());
+    if (oracle->encrypt(plaintexts, &ciphertexts) < 0)
+      return -1;
+
+    const int value = match_probe_(ciphertexts[0], secret->size(), &index);
+    if (value < 0)
+      break;
+    secret->push_back(value);
+
+    // when the byte was guessed, the next one came with it
+    const char *guess = (const char *)memchr(SPECULATION_ORDER_, value, guesses);
+    if (!guess)
+      continue;
+    const int next = match_probe_(ciphertexts[1 + (guess - SPECULATION_ORDER_)], secret->size(),
+                                  &index);
+    if (next < 0)
+      break;
+    secret->push_back(next);
+  }
+
+  // past the end, the first byte found is the 0x01 of a one-byte
+  // padding; the next one no longer matches, as it turns to 0x02
+  if (secret->empty() || secret->back() != 1) {
+    fprintf(stderr, "%s: the secret does not end with padding\n", __FUNCTION__);
+    return -1;
+  }
+  secret->pop_back();
+  return 0;
+}
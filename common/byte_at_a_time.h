@@ -0,0 +1,22 @@
+#pragma once
+
+#include <string>
+#include "oracle.h"
+
+// Recovers the secret an ECB oracle appends to each plaintext, a byte
+// at a time, with one call per byte.
+//
+// The probe for byte i is a dictionary of 256 blocks, the 15 bytes
+// before it followed by each possible value, then enough filler that
+// byte i ends a block of the secret: the one dictionary block that
+// encrypts to that block gives the byte. Both halves go in a single
+// plaintext, and the dictionary is matched through a BlockIndex.
+//
+// When the oracle takes batches, the rest of each call is spent on
+// probes for byte i + 1, assuming byte i is one of the likeliest
+// values; when one of them is right, that call recovers 2 bytes.
+//
+// The oracle must use 16-byte ECB blocks, with nothing random before
+// the plaintext; profile_oracle() checks the first part. Returns 0 on
+// success, or -1 after reporting the error.
+int recover_ecb_suffix(Oracle *oracle, std::string *secret);
@@ -0,0 +1,52 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cpu.h"
+
+static SimdLevel detect_simd_level_() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    return SIMD_AVX2;
+  if (__builtin_cpu_supports("sse2"))
+    return SIMD_SSE2;
+#endif
+  return SIMD_SCALAR;
+}
+
+static SimdLevel compute_simd_level_() {
+  SimdLevel level = detect_simd_level_();
+
+  const char *cap = getenv("CRYPTOPALS_SIMD");
+  if (!cap)
+    return level;
+
+  SimdLevel wanted;
+  if (!strcmp(cap, "scalar")) {
+    wanted = SIMD_SCALAR;
+  } else if (!strcmp(cap, "sse2")) {
+    wanted = SIMD_SSE2;
+  } else if (!strcmp(cap, "avx2")) {
+    wanted = SIMD_AVX2;
+  } else {
+    fprintf(stderr, "%s: ignoring unknown CRYPTOPALS_SIMD [%s]\n",
+            __FUNCTION__, cap);
+    return level;
+  }
+
+  return wanted < level ? wanted : level;
+}
+
+SimdLevel simd_level() {
+  static const SimdLevel level = compute_simd_level_();
+  return level;
+}
+
+bool cpu_has_aesni() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("aes");
+#else
+  return false;
+#endif
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+// SIMD levels the kernels in this directory know how to use, in
+// increasing order of preference.
+enum SimdLevel {
+  SIMD_SCALAR = 0,
+  SIMD_SSE2,
+  SIMD_AVX2,
+};
+
+// Returns the best level supported by the running cpu. Setting
+// CRYPTOPALS_SIMD=scalar|sse2|avx2 in the environment caps it, which
+// is handy to cross-check the kernels against each other.
+SimdLevel simd_level();
+
+// Whether the running cpu has the AES-NI instructions.
+bool cpu_has_aesni();
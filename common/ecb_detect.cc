@@ -0,0 +1,97 @@
+#include <stdint.h>
+#include <string.h>
+#include "ecb_detect.h"
+
+typedef unsigned __int128 Block128_;
+
+static const size_t ECB_BLOCK_SIZE_ = 16;
+
+static inline Block128_ load_block_(const unsigned char *data) {
+  Block128_ block;
+  memcpy(&block, data, ECB_BLOCK_SIZE_);
+  return block;
+}
+
+static inline uint64_t hash_block_(const Block128_ block) {
+  const uint64_t lo = (uint64_t)block;
+  const uint64_t hi = (uint64_t)(block >> 64);
+  return (lo ^ (hi * 0x9e3779b97f4a7c15ULL)) * 0xff51afd7ed558ccdULL;
+}
+
+void BlockIndex::reset(const unsigned char *data, size_t blocks) {
+  data_ = data;
+
+  // at most half full; the top bits of the hash pick the slot
+  bits_ = 4;
+  while (((size_t)1 << bits_) < 2 * blocks)
+    ++bits_;
+  slots_.assign((size_t)1 << bits_, 0);
+}
+
+size_t BlockIndex::insert(size_t b) {
+  const size_t mask = slots_.size() - 1;
+  const Block128_ block = load_block_(data_ + ECB_BLOCK_SIZE_ * b);
+
+  size_t slot = hash_block_(block) >> (64 - bits_);
+  while (true) {
+    const uint32_t entry = slots_[slot];
+    if (!entry) {
+      slots_[slot] = b + 1;
+      return b;
+    }
+    if (load_block_(data_ + ECB_BLOCK_SIZE_ * (entry - 1)) == block)
+      return entry - 1;
+    slot = (slot + 1) & mask;
+  }
+}
+
+size_t BlockIndex::find(const unsigned char *data) const {
+  const size_t mask = slots_.size() - 1;
+  const Block128_ block = load_block_(data);
+
+  size_t slot = hash_block_(block) >> (64 - bits_);
+  while (true) {
+    const uint32_t entry = slots_[slot];
+    if (!entry)
+      return NOT_FOUND;
+    if (load_block_(data_ + ECB_BLOCK_SIZE_ * (entry - 1)) == block)
+      return entry - 1;
+    slot = (slot + 1) & mask;
+  }
+}
+
+int detect_ecb(std::string_view s, const bool first_only, std::vector<RepeatedBlock> *repeats) {
+  const size_t blocks = s.size() / ECB_BLOCK_SIZE_;
+  if (repeats)
+    repeats->clear();
+
+  // counts go by the index of the first block with each value
+  static thread_local BlockIndex index;
+  static thread_local std::vector<uint32_t> counts;
+  index.reset((const unsigned char *)s.data(), blocks);
+  counts.assign(blocks, 0);
+
+  int repeated = 0;
+  for (size_t b = 0; b < blocks; ++b) {
+    const size_t first = index.insert(b);
+    ++counts[first];
+    if (first == b)
+      continue;
+
+    ++repeated;
+    if (first_only) {
+      if (repeats)
+        repeats->push_back(RepeatedBlock(ECB_BLOCK_SIZE_ * first, 2));
+      return repeated;
+    }
+  }
+
+  if (repeats) {
+    for (size_t b = 0; b < blocks; ++b) {
+      if (counts[b] > 1)
+        repeats->push_back(RepeatedBlock(ECB_BLOCK_SIZE_ * b, counts[b]));
+    }
+  }
+
+  return repeated;
+}
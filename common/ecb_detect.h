@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string_view>
+#include <vector>
+
+// A 16-byte block found more than once in a ciphertext: where it first
+// shows up, and how many times it does.
+class RepeatedBlock {
+ public:
+  RepeatedBlock(size_t offset, int count) : offset_(offset), count_(count) {}
+
+  size_t offset_;
+  int count_;
+};
+
+// An open-addressing hash of the 16-byte blocks of a buffer, compared
+// as 128-bit integers loaded straight from it. The table is kept at
+// most half full, and its memory is reused across reset() calls.
+class BlockIndex {
+ public:
+  static const size_t NOT_FOUND = (size_t)-1;
+
+  BlockIndex() : data_(NULL), bits_(0) {}
+
+  // Empties the index, to hold up to 'blocks' blocks of 'data'.
+  void reset(const unsigned char *data, size_t blocks);
+
+  // Adds block 'b' of the buffer, unless an equal one is there
+  // already. Returns the index of the first block with its value.
+  size_t insert(size_t b);
+
+  // The index of a block equal to the 16 bytes at 'block', or
+  // NOT_FOUND.
+  size_t find(const unsigned char *block) const;
+
+ private:
+  const unsigned char *data_;
+  int bits_;
+  // 1 + the index of a block, or 0 when empty
+  std::vector<uint32_t> slots_;
+};
+
+// Looks for 16-byte blocks (at offsets multiple of 16) repeated in
+// 's', the fingerprint of ECB. Returns how many blocks repeat an
+// earlier one, and stores the repeated blocks in offset order in
+// 'repeats', if not NULL. With 'first_only', stops at the first
+// repeat, which is then the only one returned.
+//
+// Blocks go through a BlockIndex reused between calls on the same
+// thread, so nothing is allocated once it has grown large enough.
+int detect_ecb(std::string_view s, const bool first_only, std::vector<RepeatedBlock> *repeats);
@@ -0,0 +1,50 @@
+#include <stdint.h>
+#include <string.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#include "cpu.h"
+#include "fixed_xor.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// Consumes whole 32-byte blocks and returns how many bytes it did.
+__attribute__((target("avx2")))
+static size_t xor_bytes_avx2_(unsigned char *out, const unsigned char *a, const unsigned char *b,
+                              size_t size) {
+  size_t i = 0;
+  for (; i + 64 <= size; i += 64) {
+    const __m256i x0 = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(a + i)),
+                                        _mm256_loadu_si256((const __m256i *)(b + i)));
+    const __m256i x1 = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(a + i + 32)),
+                                        _mm256_loadu_si256((const __m256i *)(b + i + 32)));
+    _mm256_storeu_si256((__m256i *)(out + i), x0);
+    _mm256_storeu_si256((__m256i *)(out + i + 32), x1);
+  }
+  for (; i + 32 <= size; i += 32) {
+    _mm256_storeu_si256((__m256i *)(out + i),
+                        _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(a + i)),
+                                         _mm256_loadu_si256((const __m256i *)(b + i))));
+  }
+  return i;
+}
+
+#endif
+
+void xor_bytes(unsigned char *out, const unsigned char *a, const unsigned char *b, size_t size) {
+  size_t i = 0;
+#if defined(__x86_64__) || defined(__i386__)
+  if (simd_level() >= SIMD_AVX2)
+    i = xor_bytes_avx2_(out, a, b, size);
+#endif
+
+  for (; i + 8 <= size; i += 8) {
+    uint64_t x, y;
+    memcpy(&x, a + i, 8);
+    memcpy(&y, b + i, 8);
+    x ^= y;
+    memcpy(out + i, &x, 8);
+  }
+  for (; i < size; ++i)
+    out[i] = a[i] ^ b[i];
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+#include <stddef.h>
+
+// Stores 'a' xored with 'b' at 'out', 'size' bytes of each; 'out' may
+// be either input.
+void xor_bytes(unsigned char *out, const unsigned char *a, const unsigned char *b, size_t size);
@@ -0,0 +1,256 @@
+#include <stdio.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#include "cpu.h"
+#include "hex.h"
+
+static int hex_digit_(unsigned char c) {
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  c |= 0x20; // fold upper case
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  return -1;
+}
+
+static int hex_decode_scalar_(unsigned char *out, const char *in, size_t size,
+                              size_t offset) {
+  for (size_t i = 0; i < size; i += 2) {
+    int hi = hex_digit_(in[i]);
+    int lo = hex_digit_(in[i + 1]);
+    if (hi < 0 || lo < 0) {
+      const size_t bad = hi < 0 ? i : i + 1;
+      fprintf(stderr, "%s: unexpected char %d at offset %ld\n",
+              __FUNCTION__, (unsigned char)in[bad], offset + bad);
+      return -1;
+    }
+    out[i / 2] = (hi << 4) | lo;
+  }
+  return 0;
+}
+
+static void hex_encode_scalar_(char *out, const unsigned char *in, size_t size) {
+  static const char digits[] = "0123456789abcdef";
+  for (size_t i = 0; i < size; ++i) {
+    out[2 * i] = digits[in[i] >> 4];
+    out[2 * i + 1] = digits[in[i] & 0x0f];
+  }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// The vector kernels below work on whole blocks and return how many
+// input bytes they consumed; whatever is left (the tail, or a block
+// holding a bad char) goes through the scalar code, which also takes
+// care of reporting the exact offset of errors.
+
+// Maps 16 hex digits to their nibble values; 'valid' gets 0xff in
+// each lane holding a hex digit.
+static inline __m128i hex_nibbles_sse2_(__m128i c, __m128i *valid) {
+  const __m128i digit = _mm_sub_epi8(c, _mm_set1_epi8('0'));
+  const __m128i alpha = _mm_sub_epi8(_mm_or_si128(c, _mm_set1_epi8(0x20)),
+                                     _mm_set1_epi8('a'));
+  // unsigned x <= n is min(x, n) == x
+  const __m128i is_digit = _mm_cmpeq_epi8(_mm_min_epu8(digit, _mm_set1_epi8(9)), digit);
+  const __m128i is_alpha = _mm_cmpeq_epi8(_mm_min_epu8(alpha, _mm_set1_epi8(5)), alpha);
+  *valid = _mm_or_si128(is_digit, is_alpha);
+  return _mm_or_si128(_mm_and_si128(is_digit, digit),
+                      _mm_and_si128(is_alpha, _mm_add_epi8(alpha, _mm_set1_epi8(10))));
+}
+
+// Joins each pair of nibbles (high nibble first) into a 16-bit lane.
+static inline __m128i hex_join_sse2_(__m128i nibbles) {
+  const __m128i hi = _mm_and_si128(_mm_slli_epi16(nibbles, 4), _mm_set1_epi16(0x00f0));
+  const __m128i lo = _mm_srli_epi16(nibbles, 8);
+  return _mm_or_si128(hi, lo);
+}
+
+static size_t hex_decode_sse2_(unsigned char *out, const char *in, size_t size) {
+  size_t i = 0;
+  for (; i + 32 <= size; i += 32) {
+    __m128i valid0, valid1;
+    const __m128i n0 = hex_nibbles_sse2_(
+        _mm_loadu_si128((const __m128i *)(in + i)), &valid0);
+    const __m128i n1 = hex_nibbles_sse2_(
+        _mm_loadu_si128((const __m128i *)(in + i + 16)), &valid1);
+    if (_mm_movemask_epi8(_mm_and_si128(valid0, valid1)) != 0xffff)
+      break;
+    _mm_storeu_si128((__m128i *)(out + i / 2),
+                     _mm_packus_epi16(hex_join_sse2_(n0), hex_join_sse2_(n1)));
+  }
+  return i;
+}
+
+static inline __m128i hex_digits_sse2_(__m128i nibbles) {
+  // '0' + n, plus the gap between '9' + 1 and 'a' for n > 9
+  const __m128i gap = _mm_and_si128(_mm_cmpgt_epi8(nibbles, _mm_set1_epi8(9)),
+                                    _mm_set1_epi8('a' - '0' - 10));
+  return _mm_add_epi8(_mm_add_epi8(nibbles, _mm_set1_epi8('0')), gap);
+}
+
+static size_t hex_encode_sse2_(char *out, const unsigned char *in, size_t size) {
+  size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    const __m128i x = _mm_loadu_si128((const __m128i *)(in + i));
+    const __m128i hi = hex_digits_sse2_(_mm_and_si128(_mm_srli_epi16(x, 4), _mm_set1_epi8(0x0f)));
+    const __m128i lo = hex_digits_sse2_(_mm_and_si128(x, _mm_set1_epi8(0x0f)));
+    _mm_storeu_si128((__m128i *)(out + 2 * i), _mm_unpacklo_epi8(hi, lo));
+    _mm_storeu_si128((__m128i *)(out + 2 * i + 16), _mm_unpackhi_epi8(hi, lo));
+  }
+  return i;
+}
+
+__attribute__((target("avx2")))
+static inline __m256i hex_nibbles_avx2_(__m256i c, __m256i *valid) {
+  const __m256i digit = _mm256_sub_epi8(c, _mm256_set1_epi8('0'));
+  const __m256i alpha = _mm256_sub_epi8(_mm256_or_si256(c, _mm256_set1_epi8(0x20)),
+                                        _mm256_set1_epi8('a'));
+  const __m256i is_digit = _mm256_cmpeq_epi8(_mm256_min_epu8(digit, _mm256_set1_epi8(9)), digit);
+  const __m256i is_alpha = _mm256_cmpeq_epi8(_mm256_min_epu8(alpha, _mm256_set1_epi8(5)), alpha);
+  *valid = _mm256_or_si256(is_digit, is_alpha);
+  return _mm256_or_si256(_mm256_and_si256(is_digit, digit),
+                         _mm256_and_si256(is_alpha, _mm256_add_epi8(alpha, _mm256_set1_epi8(10))));
+}
+
+__attribute__((target("avx2")))
+static size_t hex_decode_avx2_(unsigned char *out, const char *in, size_t size) {
+  // (16 * hi + lo) for each pair of nibbles, one 16-bit lane per pair
+  const __m256i weights = _mm256_set1_epi16(0x0110);
+
+  size_t i = 0;
+  for (; i + 64 <= size; i += 64) {
+    __m256i valid0, valid1;
+    const __m256i n0 = hex_nibbles_avx2_(
+        _mm256_loadu_si256((const __m256i *)(in + i)), &valid0);
+    const __m256i n1 = hex_nibbles_avx2_(
+        _mm256_loadu_si256((const __m256i *)(in + i + 32)), &valid1);
+    if (_mm256_movemask_epi8(_mm256_and_si256(valid0, valid1)) != -1)
+      break;
+    const __m256i packed = _mm256_packus_epi16(_mm256_maddubs_epi16(n0, weights),
+                                               _mm256_maddubs_epi16(n1, weights));
+    // packus works per 128-bit lane, put the quadwords back in order
+    _mm256_storeu_si256((__m256i *)(out + i / 2),
+                        _mm256_permute4x64_epi64(packed, 0xd8));
+  }
+  return i;
+}
+
+__attribute__((target("avx2")))
+static size_t hex_encode_avx2_(char *out, const unsigned char *in, size_t size) {
+  const __m256i digits = _mm256_setr_epi8(
+      '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f',
+      '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+  const __m256i mask = _mm256_set1_epi8(0x0f);
+
+  size_t i = 0;
+  for (; i + 32 <= size; i += 32) {
+    const __m256i x = _mm256_loadu_si256((const __m256i *)(in + i));
+    const __m256i hi = _mm256_shuffle_epi8(digits, _mm256_and_si256(_mm256_srli_epi16(x, 4), mask));
+    const __m256i lo = _mm256_shuffle_epi8(digits, _mm256_and_si256(x, mask));
+    // unpack works per 128-bit lane: a = bytes 0-7 | 16-23, b = 8-15 | 24-31
+    const __m256i a = _mm256_unpacklo_epi8(hi, lo);
+    const __m256i b = _mm256_unpackhi_epi8(hi, lo);
+    _mm256_storeu_si256((__m256i *)(out + 2 * i), _mm256_permute2x128_si256(a, b, 0x20));
+    _mm256_storeu_si256((__m256i *)(out + 2 * i + 32), _mm256_permute2x128_si256(a, b, 0x31));
+  }
+  return i;
+}
+
+#endif
+
+int hex_decode(unsigned char *out, const char *in, size_t size) {
+  if (size % 2) {
+    fprintf(stderr, "%s: buffer with odd number of chars (%ld)\n",
+            __FUNCTION__, size);
+    return -1;
+  }
+
+  size_t done = 0;
+#if defined(__x86_64__) || defined(__i386__)
+  switch (simd_level()) {
+    case SIMD_AVX2:
+      done = hex_decode_avx2_(out, in, size);
+      break;
+    case SIMD_SSE2:
+      done = hex_decode_sse2_(out, in, size);
+      break;
+    default:
+      break;
+  }
+#endif
+
+  return hex_decode_scalar_(out + done / 2, in + done, size - done, done);
+}
+
+void hex_encode(char *out, const unsigned char *in, size_t size) {
+  size_t done = 0;
+#if defined(__x86_64__) || defined(__i386__)
+  switch (simd_level()) {
+    case SIMD_AVX2:
+      done = hex_encode_avx2_(out, in, size);
+      break;
+    case SIMD_SSE2:
+      done = hex_encode_sse2_(out, in, size);
+      break;
+    default:
+      break;
+  }
+#endif
+
+  hex_encode_scalar_(out + 2 * done, in + done, size - done);
+}
+
+int decodehex(std::string *decoded, std::string_view s) {
+  size_t size = s.size();
+  if (size && s[size - 1] == '\n')
+    --size;
+
+  decoded->resize(size / 2);
+  return hex_decode((unsigned char *)&(*decoded)[0], s.data(), size);
+}
+
+void encodehex(std::string *encoded, std::string_view s) {
+  encoded->resize(s.size() * 2);
+  hex_encode(&(*encoded)[0], (const unsigned char *)s.data(), s.size());
+}
+
+// hex digits buffered by HexWriter between writes
+static const size_t HEX_WRITER_BUFFER_SIZE_ = 64 * 1024;
+
+HexWriter::HexWriter(FILE *out)
+    : out_(out), buffer_(HEX_WRITER_BUFFER_SIZE_, '\0'), used_(0), failed_(false) {}
+
+HexWriter::~HexWriter() {
+  flush();
+}
+
+int HexWriter::write(const unsigned char *data, size_t size) {
+  while (size) {
+    if (used_ == buffer_.size() && flush() < 0)
+      return -1;
+
+    size_t block = (buffer_.size() - used_) / 2;
+    if (block > size)
+      block = size;
+    hex_encode(&buffer_[used_], data, block);
+    used_ += 2 * block;
+    data += block;
+    size -= block;
+  }
+
+  return failed_ ? -1 : 0;
+}
+
+int HexWriter::flush() {
+  if (failed_)
+    return -1;
+
+  if (used_ && fwrite(buffer_.data(), 1, used_, out_) != used_) {
+    fprintf(stderr, "%s: write error\n", __FUNCTION__);
+    failed_ = true;
+    return -1;
+  }
+  used_ = 0;
+  return 0;
+}
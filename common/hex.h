@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string>
+#include <string_view>
+
+// Decodes 'size' hex digits (lower or upper case) from 'in' into
+// 'size / 2' bytes at 'out'. Returns 0 on success, or -1 if 'size' is
+// odd or a non-hex char is found (its offset is reported on stderr).
+int hex_decode(unsigned char *out, const char *in, size_t size);
+
+// Encodes 'size' bytes from 'in' as '2 * size' lowercase hex digits
+// at 'out'.
+void hex_encode(char *out, const unsigned char *in, size_t size);
+
+// std::string wrappers around the two functions above; decodehex()
+// ignores a single trailing newline.
+int decodehex(std::string *decoded, std::string_view s);
+void encodehex(std::string *encoded, std::string_view s);
+
+// Writes bytes to 'out' as lowercase hex, encoding whole blocks into
+// a reusable buffer and handing it to stdio in large writes.
+class HexWriter {
+ public:
+  explicit HexWriter(FILE *out);
+  // Flushes what is left.
+  ~HexWriter();
+
+  HexWriter(const HexWriter &) = delete;
+  HexWriter &operator=(const HexWriter &) = delete;
+
+  // Return 0 on success, or -1 after reporting a write error; once a
+  // write failed, later calls fail too.
+  int write(const unsigned char *data, size_t size);
+  int write(std::string_view s) {
+    return write((const unsigned char *)s.data(), s.size());
+  }
+  int flush();
+
+ private:
+  FILE *out_;
+  std::string buffer_;
+  size_t used_;
+  bool failed_;
+};
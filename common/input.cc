@@ -0,0 +1,124 @@
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "input.h"
+
+// chunk size for inputs that cannot be mapped
+static const size_t INPUT_CHUNK_SIZE_ = 1 << 20;
+
+// Maps 'fd' if it is a non-empty regular file. Returns the mapping, or
+// NULL if the caller should fall back to read().
+static void *input_map_(int fd, size_t *size) {
+  struct stat st;
+  if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) || st.st_size <= 0)
+    return NULL;
+
+  void *mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (mapping == MAP_FAILED)
+    return NULL;
+
+  // we always scan front to back
+  madvise(mapping, st.st_size, MADV_SEQUENTIAL);
+  *size = st.st_size;
+  return mapping;
+}
+
+// Like read(), but retries on EINTR.
+static ssize_t input_read_(int fd, char *buf, size_t size) {
+  while (true) {
+    ssize_t got = read(fd, buf, size);
+    if (got >= 0 || errno != EINTR)
+      return got;
+  }
+}
+
+InputBuffer::InputBuffer() : data_(NULL), size_(0), mapping_(NULL) {}
+
+InputBuffer::~InputBuffer() {
+  release_();
+}
+
+void InputBuffer::release_() {
+  if (mapping_)
+    munmap(mapping_, size_);
+  mapping_ = NULL;
+  owned_.clear();
+  data_ = NULL;
+  size_ = 0;
+}
+
+int InputBuffer::load(const char *path) {
+  if (!strcmp(path, "-"))
+    return load_fd(STDIN_FILENO);
+
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    fprintf(stderr, "%s: cannot open [%s]: %s\n", __FUNCTION__, path, strerror(errno));
+    return -1;
+  }
+
+  int result = load_fd(fd);
+  close(fd);
+  return result;
+}
+
+int InputBuffer::load_fd(int fd) {
+  release_();
+
+  mapping_ = input_map_(fd, &size_);
+  if (mapping_) {
+    data_ = (const char *)mapping_;
+    return 0;
+  }
+
+  // grow the buffer geometrically, reading straight into it
+  size_t used = 0;
+  while (true) {
+    if (owned_.size() - used < INPUT_CHUNK_SIZE_)
+      owned_.resize(owned_.size() * 2 + INPUT_CHUNK_SIZE_);
+
+    ssize_t got = input_read_(fd, &owned_[used], owned_.size() - used);
+    if (got < 0) {
+      fprintf(stderr, "%s: read error: %s\n", __FUNCTION__, strerror(errno));
+      release_();
+      return -1;
+    }
+    if (got == 0)
+      // EOF
+      break;
+    used += got;
+  }
+
+  owned_.resize(used);
+  data_ = owned_.data();
+  size_ = used;
+  return 0;
+}
+
+int read_input_chunks(int fd, const InputSink &sink) {
+  size_t size;
+  void *mapping = input_map_(fd, &size);
+  if (mapping) {
+    int result = sink(std::string_view((const char *)mapping, size));
+    munmap(mapping, size);
+    return result;
+  }
+
+  std::string chunk(INPUT_CHUNK_SIZE_, '\0');
+  while (true) {
+    ssize_t got = input_read_(fd, &chunk[0], chunk.size());
+    if (got < 0) {
+      fprintf(stderr, "%s: read error: %s\n", __FUNCTION__, strerror(errno));
+      return -1;
+    }
+    if (got == 0)
+      // EOF
+      return 0;
+    if (sink(std::string_view(chunk.data(), got)) < 0)
+      return -1;
+  }
+}
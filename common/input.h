@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stddef.h>
+#include <functional>
+#include <string>
+#include <string_view>
+
+// Read-only view of a whole input. Regular files are memory mapped,
+// anything else (pipes, terminals) is read in large chunks into a
+// buffer owned by the object.
+class InputBuffer {
+ public:
+  InputBuffer();
+  ~InputBuffer();
+
+  InputBuffer(const InputBuffer &) = delete;
+  InputBuffer &operator=(const InputBuffer &) = delete;
+
+  // Loads the file at 'path' ("-" means stdin), or what 'fd' refers
+  // to. Return 0 on success, or -1 after reporting the error.
+  int load(const char *path);
+  int load_fd(int fd);
+
+  std::string_view view() const {
+    return std::string_view(data_, size_);
+  }
+
+ private:
+  void release_();
+
+  const char *data_;
+  size_t size_;
+  // set when data_ points to a mapping rather than to owned_
+  void *mapping_;
+  std::string owned_;
+};
+
+typedef std::function<int(std::string_view chunk)> InputSink;
+
+// Hands the whole of 'fd' to 'sink' as read-only views, in bounded
+// memory: a regular file is mapped and passed in one go, anything
+// else is read and passed in 1 MB chunks. Stops and returns -1 if the
+// sink does, or on read errors; returns 0 otherwise.
+int read_input_chunks(int fd, const InputSink &sink);
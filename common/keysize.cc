@@ -0,0 +1,176 @@
+#include <string.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#include <algorithm>
+#include "cpu.h"
+#include "keysize.h"
+#include "strided_view.h"
+#include "xor_search.h"
+
+static uint64_t hamming_distance_scalar_(const unsigned char *a, const unsigned char *b,
+                                         size_t size) {
+  uint64_t distance = 0;
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    uint64_t x, y;
+    memcpy(&x, a + i, 8);
+    memcpy(&y, b + i, 8);
+    distance += __builtin_popcountll(x ^ y);
+  }
+  for (; i < size; ++i)
+    distance += __builtin_popcount(a[i] ^ b[i]);
+  return distance;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// Counts bits with a 16-entry table of nibble counts looked up with
+// pshufb; byte counts are summed for a while, then widened with psadbw.
+// Consumes whole 32-byte blocks, adding their distance to 'distance',
+// and returns how many bytes it consumed.
+__attribute__((target("avx2")))
+static size_t hamming_distance_avx2_(const unsigned char *a, const unsigned char *b,
+                                     size_t size, uint64_t *distance) {
+  const __m256i counts = _mm256_setr_epi8(
+      0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+      0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i mask = _mm256_set1_epi8(0x0f);
+  __m256i total = _mm256_setzero_si256();
+
+  size_t i = 0;
+  while (i + 32 <= size) {
+    // each byte lane gains at most 8 per block, so 31 blocks fit
+    __m256i partial = _mm256_setzero_si256();
+    for (int blocks = 0; blocks < 31 && i + 32 <= size; ++blocks, i += 32) {
+      const __m256i x = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(a + i)),
+                                         _mm256_loadu_si256((const __m256i *)(b + i)));
+      const __m256i lo = _mm256_shuffle_epi8(counts, _mm256_and_si256(x, mask));
+      const __m256i hi = _mm256_shuffle_epi8(counts, _mm256_and_si256(_mm256_srli_epi16(x, 4), mask));
+      partial = _mm256_add_epi8(partial, _mm256_add_epi8(lo, hi));
+    }
+    total = _mm256_add_epi64(total, _mm256_sad_epu8(partial, _mm256_setzero_si256()));
+  }
+
+  uint64_t lanes[4];
+  _mm256_storeu_si256((__m256i *)lanes, total);
+  *distance += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+  return i;
+}
+
+#endif
+
+uint64_t hamming_distance(const unsigned char *a, const unsigned char *b, size_t size) {
+  uint64_t distance = 0;
+  size_t done = 0;
+#if defined(__x86_64__) || defined(__i386__)
+  if (simd_level() >= SIMD_AVX2)
+    done = hamming_distance_avx2_(a, b, size, &distance);
+#endif
+
+  return distance + hamming_distance_scalar_(a + done, b + done, size - done);
+}
+
+int64_t hamming_distance(std::string_view a, std::string_view b) {
+  if (a.size() != b.size())
+    // cannot compute distance
+    return -1;
+
+  return hamming_distance((const unsigned char *)a.data(), (const unsigned char *)b.data(),
+                          a.size());
+}
+
+// Every pair of adjacent blocks at once: the input against itself
+// shifted by one block.
+static double rate_keysize_hamming_(std::string_view s, const int keysize) {
+  const size_t compared = (s.size() / keysize - 1) * keysize;
+  const unsigned char *p = (const unsigned char *)s.data();
+  return -(double)hamming_distance(p, p + keysize, compared) / compared;
+}
+
+static double rate_keysize_coincidence_(std::string_view s, const int keysize) {
+  double sum = 0.0;
+  for (int column = 0; column < keysize; ++column) {
+    const ByteHistogram histogram(column_view(s, keysize, column));
+    const double n = histogram.total_;
+    uint64_t pairs = 0;
+    for (int i = 0; i < histogram.present_count_; ++i) {
+      const uint64_t count = histogram.count_[histogram.present_[i]];
+      pairs += count * (count - 1);
+    }
+    sum += 256.0 * pairs / (n * (n - 1));
+  }
+  return sum / keysize;
+}
+
+double rate_keysize(std::string_view s, const int keysize, const KeysizeEstimator estimator) {
+  if (s.size() > KEYSIZE_SAMPLE_SIZE)
+    s = s.substr(0, KEYSIZE_SAMPLE_SIZE);
+  if (keysize < 1 || s.size() / keysize < 2)
+    return KEYSIZE_UNRATED;
+
+  switch (estimator) {
+    case KEYSIZE_COINCIDENCE:
+      return rate_keysize_coincidence_(s, keysize);
+    case KEYSIZE_HAMMING:
+    default:
+      return rate_keysize_hamming_(s, keysize);
+  }
+}
+
+std::vector<int> likely_keysizes(std::string_view s, const int min_keysize, const int max_keysize,
+                                 const KeysizeEstimator estimator, const size_t count) {
+  // rates[k - min_keysize] for each rated keysize k
+  std::vector<double> rates;
+  for (int keysize = min_keysize; keysize <= max_keysize; ++keysize) {
+    const double rate = rate_keysize(s, keysize, estimator);
+    if (rate == KEYSIZE_UNRATED)
+      break;
+    rates.push_back(rate);
+  }
+  if (rates.empty())
+    return std::vector<int>();
+
+  std::vector<int> ranked;
+  for (size_t i = 0; i < rates.size(); ++i)
+    ranked.push_back(min_keysize + i);
+  std::stable_sort(ranked.begin(), ranked.end(), [&rates, min_keysize](int a, int b) {
+      return rates[a - min_keysize] > rates[b - min_keysize];
+    });
+
+  // at most half the keysizes are multiples of the key size, so the
+  // lower quartile rates like a wrong keysize
+  const double wrong = rates[ranked[ranked.size() * 3 / 4] - min_keysize];
+
+  // each keysize brings in first those of its divisors that rate about
+  // as well and are not in yet, smallest first
+  std::vector<bool> taken(rates.size(), false);
+  std::vector<int> keysizes;
+  for (const int keysize : ranked) {
+    const double rate = rates[keysize - min_keysize];
+    const double tolerance = KEYSIZE_DIVISOR_TOLERANCE * (rate - wrong);
+    for (int divisor = min_keysize; divisor <= keysize && keysizes.size() < count; ++divisor) {
+      if (keysize % divisor || taken[divisor - min_keysize])
+        continue;
+      if (divisor == keysize || rates[divisor - min_keysize] >= rate - tolerance) {
+        taken[divisor - min_keysize] = true;
+        keysizes.push_back(divisor);
+      }
+    }
+    if (keysizes.size() >= count)
+      break;
+  }
+
+  return keysizes;
+}
+
+int parse_keysize_estimator(const char *name, KeysizeEstimator *estimator) {
+  if (!strcmp(name, "hamming")) {
+    *estimator = KEYSIZE_HAMMING;
+  } else if (!strcmp(name, "coincidence")) {
+    *estimator = KEYSIZE_COINCIDENCE;
+  } else {
+    return -1;
+  }
+  return 0;
+}
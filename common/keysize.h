@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string_view>
+#include <vector>
+
+// Number of differing bits between the 'size' bytes at 'a' and at 'b'.
+uint64_t hamming_distance(const unsigned char *a, const unsigned char *b, size_t size);
+// Same on two views, or -1 if their sizes differ.
+int64_t hamming_distance(std::string_view a, std::string_view b);
+
+// Ways to tell how likely a ciphertext is to be xored with a
+// repeating key of a given size.
+enum KeysizeEstimator {
+  // minus the Hamming distance between each block of keysize bytes
+  // and the next one, per byte: bytes xored with the same key byte
+  // differ as much as the cleartext ones, random ones differ more
+  KEYSIZE_HAMMING = 0,
+  // average index of coincidence of the columns of the input cut in
+  // rows of keysize bytes, times 256: a column xored with a single
+  // byte keeps the (high) one of its cleartext
+  KEYSIZE_COINCIDENCE,
+};
+
+// marks keysizes the input is too short to rate
+static const double KEYSIZE_UNRATED = -1e300;
+
+// At most this many bytes from the start of the input are looked at,
+// which is plenty to tell keysizes apart and keeps the cost of a
+// sweep flat on large inputs.
+static const size_t KEYSIZE_SAMPLE_SIZE = 64 * 1024;
+
+// Rates 'keysize' for 's'; higher is more likely. Keysizes leaving
+// fewer than two full blocks are KEYSIZE_UNRATED.
+double rate_keysize(std::string_view s, const int keysize, const KeysizeEstimator estimator);
+
+// A multiple of the key size rates about as well as the size itself,
+// often a little better by chance, and with Hamming up to about 12%
+// better for keys of a few bytes (bytes that close in English text are
+// less alike than ones further apart). A keysize is taken to be the
+// real one when it rates closer to a multiple of its than this
+// fraction of the multiple's lead over the lower quartile of rates,
+// where only wrong keysizes are.
+static const double KEYSIZE_DIVISOR_TOLERANCE = 0.35;
+
+// Rates every keysize in [min_keysize, max_keysize] and returns the
+// 'count' most likely ones, best first; keysizes too long for the
+// input are left out. Each keysize comes after its divisors that rate
+// within KEYSIZE_DIVISOR_TOLERANCE of it, and on equal rates after the
+// smaller keysizes.
+std::vector<int> likely_keysizes(std::string_view s, const int min_keysize, const int max_keysize,
+                                 const KeysizeEstimator estimator, const size_t count);
+
+// Parses "hamming" or "coincidence". Returns 0 on success, -1 on
+// unknown names.
+int parse_keysize_estimator(const char *name, KeysizeEstimator *estimator);
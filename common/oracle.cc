@@ -0,0 +1,25 @@
+#include <stdio.h>
+#include "oracle.h"
+
+int Oracle::encrypt(const std::vector<std::string_view> &plaintexts,
+                    std::vector<std::string> *ciphertexts) {
+  if (plaintexts.empty() || plaintexts.size() > max_batch()) {
+    fprintf(stderr, "%s: %ld plaintexts for a batch of at most %ld\n", __FUNCTION__,
+            plaintexts.size(), max_batch());
+    return -1;
+  }
+
+  ++calls_;
+  plaintexts_ += plaintexts.size();
+  ciphertexts->resize(plaintexts.size());
+  return encrypt_(plaintexts, ciphertexts);
+}
+
+int Oracle::encrypt(std::string_view plaintext, std::string *ciphertext) {
+  std::vector<std::string> ciphertexts;
+  if (encrypt(std::vector<std::string_view>(1, plaintext), &ciphertexts) < 0)
+    return -1;
+
+  ciphertext->swap(ciphertexts[0]);
+  return 0;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stddef.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A chosen-plaintext encryption oracle: something that encrypts the
+// plaintexts it is handed, usually with secrets of its own around
+// them. Each call costs, so the oracle counts them; an oracle that
+// takes several plaintexts per call says so with max_batch().
+class Oracle {
+ public:
+  Oracle() : calls_(0), plaintexts_(0) {}
+  virtual ~Oracle() {}
+
+  // Encrypts each of 'plaintexts' into the matching entry of
+  // 'ciphertexts', in one call to the oracle; there may not be more
+  // than max_batch() of them. Returns 0 on success, or -1 after
+  // reporting the error.
+  int encrypt(const std::vector<std::string_view> &plaintexts,
+              std::vector<std::string> *ciphertexts);
+  int encrypt(std::string_view plaintext, std::string *ciphertext);
+
+  // The most plaintexts a single call takes.
+  virtual size_t max_batch() const {
+    return 1;
+  }
+
+  // calls made, and plaintexts encrypted, since the last reset
+  size_t calls() const {
+    return calls_;
+  }
+  size_t plaintexts() const {
+    return plaintexts_;
+  }
+  void reset_counters() {
+    calls_ = 0;
+    plaintexts_ = 0;
+  }
+
+ protected:
+  // Does the work of encrypt(), which has checked the batch size.
+  virtual int encrypt_(const std::vector<std::string_view> &plaintexts,
+                       std::vector<std::string> *ciphertexts) = 0;
+
+ private:
+  size_t calls_;
+  size_t plaintexts_;
+};
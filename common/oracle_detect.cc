@@ -0,0 +1,62 @@
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "oracle_detect.h"
+
+// The smallest block size for which 'ciphertext' has two equal
+// adjacent blocks, or 0.
+static size_t repeated_block_size_(std::string_view ciphertext) {
+  for (size_t block_size = MIN_BLOCK_SIZE; block_size <= MAX_BLOCK_SIZE; ++block_size) {
+    if (ciphertext.size() % block_size)
+      continue;
+
+    for (size_t offset = 0; offset + 2 * block_size <= ciphertext.size(); offset += block_size)
+      if (!memcmp(ciphertext.data() + offset, ciphertext.data() + offset + block_size, block_size))
+        return block_size;
+  }
+
+  return 0;
+}
+
+int profile_oracle(Oracle *oracle, OracleProfile *profile) {
+  // the ECB probe, then the length probes: its prefixes of 0 to
+  // MAX_BLOCK_SIZE bytes
+  const std::string probe(3 * MAX_BLOCK_SIZE, 'A');
+  std::vector<std::string_view> probes(1, probe);
+  for (size_t length = 0; length <= MAX_BLOCK_SIZE; ++length)
+    probes.push_back(std::string_view(probe).substr(0, length));
+
+  const size_t batch = oracle->max_batch();
+  std::vector<std::string_view> plaintexts;
+  std::vector<std::string> ciphertexts;
+  size_t first_length = 0;
+  for (size_t sent = 0; sent < probes.size(); sent += plaintexts.size()) {
+    const size_t count = probes.size() - sent < batch ? probes.size() - sent : batch;
+    plaintexts.assign(probes.begin() + sent, probes.begin() + sent + count);
+    if (oracle->encrypt(plaintexts, &ciphertexts) < 0)
+      return -1;
+
+    for (size_t i = 0; i < count; ++i) {
+      const size_t length = ciphertexts[i].size();
+      if (sent + i == 0) {
+        const size_t block_size = repeated_block_size_(ciphertexts[i]);
+        if (block_size) {
+          profile->block_size_ = block_size;
+          profile->ecb_ = true;
+          return 0;
+        }
+      } else if (sent + i == 1) {
+        first_length = length;
+      } else if (length != first_length) {
+        profile->block_size_ = length > first_length ? length - first_length : first_length - length;
+        profile->ecb_ = false;
+        return 0;
+      }
+    }
+  }
+
+  fprintf(stderr, "%s: no block size up to %ld found\n", __FUNCTION__, MAX_BLOCK_SIZE);
+  return -1;
+}
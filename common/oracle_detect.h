@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stddef.h>
+#include "oracle.h"
+
+// block sizes the detector knows how to find
+static const size_t MIN_BLOCK_SIZE = 8;
+static const size_t MAX_BLOCK_SIZE = 64;
+
+// What probing an oracle found out about its cipher.
+class OracleProfile {
+ public:
+  OracleProfile() : block_size_(0), ecb_(false) {}
+
+  size_t block_size_;
+  bool ecb_;
+};
+
+// Works out the block size of 'oracle' and whether it uses ECB, with
+// as few calls as it can. The first probe is 3 * MAX_BLOCK_SIZE equal
+// bytes: under ECB they encrypt to equal adjacent blocks, whatever
+// comes before them, and the smallest size for which blocks repeat is
+// the block size, so ECB oracles cost one plaintext. Otherwise the
+// block size is the first jump in ciphertext length as the plaintext
+// grows a byte at a time; that still holds when the oracle pads each
+// message randomly, as long as the padding varies by less than a
+// block. All probes go out in batches as large as the oracle takes,
+// so with a batch of MAX_BLOCK_SIZE + 2 or more it all fits in one
+// call.
+//
+// Returns 0 on success, or -1 after reporting the error.
+int profile_oracle(Oracle *oracle, OracleProfile *profile);
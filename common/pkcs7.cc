@@ -0,0 +1,70 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "pkcs7.h"
+
+// All ones when a < b, zero otherwise; both below 2^31.
+static inline uint32_t mask_less_(const uint32_t a, const uint32_t b) {
+  return 0 - ((a - b) >> 31);
+}
+
+// All ones when a == b, zero otherwise; both below 2^31.
+static inline uint32_t mask_equal_(const uint32_t a, const uint32_t b) {
+  return 0 - (((a ^ b) - 1) >> 31);
+}
+
+static bool valid_block_size_(const size_t block_size) {
+  return block_size >= 1 && block_size <= 255;
+}
+
+int pkcs7_pad(unsigned char *data, size_t size, const size_t block_size, size_t *padded) {
+  if (!valid_block_size_(block_size)) {
+    fprintf(stderr, "%s: bad block size %ld\n", __FUNCTION__, block_size);
+    return -1;
+  }
+
+  const size_t padding = pkcs7_padding(size, block_size);
+  memset(data + size, (int)padding, padding);
+  *padded = size + padding;
+  return 0;
+}
+
+int pkcs7_pad(std::string *s, const size_t block_size) {
+  if (!valid_block_size_(block_size)) {
+    fprintf(stderr, "%s: bad block size %ld\n", __FUNCTION__, block_size);
+    return -1;
+  }
+
+  const size_t padding = pkcs7_padding(s->size(), block_size);
+  s->append(padding, (char)padding);
+  return 0;
+}
+
+int pkcs7_unpad(const unsigned char *data, size_t size, const size_t block_size,
+                size_t *unpadded) {
+  // sizes are public, only the contents need hiding
+  *unpadded = size;
+  if (!valid_block_size_(block_size) || !size || size % block_size)
+    return -1;
+
+  const unsigned char *last = data + size - block_size;
+  const uint32_t padding = data[size - 1];
+  uint32_t good = ~mask_equal_(padding, 0) & mask_less_(padding, block_size + 1);
+  for (uint32_t i = 0; i < block_size; ++i) {
+    // bytes within the padding must hold its length
+    const uint32_t in_padding = mask_less_(i, padding);
+    good &= ~in_padding | mask_equal_(last[block_size - 1 - i], padding);
+  }
+
+  *unpadded = size - (padding & good);
+  return (int)(good & 1) - 1;
+}
+
+int pkcs7_unpad(std::string *s, const size_t block_size) {
+  size_t unpadded;
+  if (pkcs7_unpad((const unsigned char *)s->data(), s->size(), block_size, &unpadded) < 0)
+    return -1;
+
+  s->resize(unpadded);
+  return 0;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stddef.h>
+#include <string>
+
+// PKCS#7 padding, for block sizes from 1 to 255 bytes. A message
+// always gets 1 to 'block_size' bytes of padding, each holding the
+// number of padding bytes, so a whole extra block when its length is
+// already aligned.
+
+// Number of padding bytes for a message of 'size' bytes.
+inline size_t pkcs7_padding(const size_t size, const size_t block_size) {
+  return block_size - size % block_size;
+}
+
+// Pads the 'size' bytes at 'data' in place, writing the padding right
+// after them: there must be room for pkcs7_padding() more bytes.
+// Stores the padded size in 'padded'. Since the padding only depends
+// on the length modulo the block size, 'data' may be just the last
+// chunk of a stream, at least the bytes after its last whole block.
+// Returns 0 on success, or -1 on a bad block size.
+int pkcs7_pad(unsigned char *data, size_t size, const size_t block_size, size_t *padded);
+
+// Pads 's' in place; no allocation when its capacity has room for the
+// padding. Returns 0 on success, or -1 on a bad block size.
+int pkcs7_pad(std::string *s, const size_t block_size);
+
+// Checks the padding of the 'size' bytes at 'data', a non-zero
+// multiple of 'block_size', and stores in 'unpadded' the size without
+// it. The check reads the whole last block whatever it holds, without
+// branching on its contents, so its timing does not depend on where
+// the padding goes wrong; 'unpadded' is then 'size'. Returns 0 on
+// success, or -1 on bad padding (not reported, as a padding oracle
+// would want to know) or a bad size.
+int pkcs7_unpad(const unsigned char *data, size_t size, const size_t block_size,
+                size_t *unpadded);
+
+// Removes the padding of 's' in place, without reallocating. Returns
+// 0 on success, or -1 leaving it unchanged.
+int pkcs7_unpad(std::string *s, const size_t block_size);
@@ -0,0 +1,120 @@
+#include <stdint.h>
+#include <string.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#include "cpu.h"
+#include "repeating_key.h"
+
+// widest vector the kernels below use
+static const size_t PATTERN_VECTOR_SIZE_ = 32;
+// keys longer than this use a period of their own size: it is already
+// longer than a vector, and the lcm would get large
+static const size_t PATTERN_MAX_LCM_ = 4096;
+
+static size_t gcd_(size_t a, size_t b) {
+  while (b) {
+    const size_t t = a % b;
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+RepeatingKeyXor::RepeatingKeyXor(std::string_view key)
+    : offset_(0) {
+  const size_t key_size = key.size();
+  period_ = key_size / gcd_(key_size, PATTERN_VECTOR_SIZE_) * PATTERN_VECTOR_SIZE_;
+  if (period_ > PATTERN_MAX_LCM_)
+    period_ = key_size;
+
+  pattern_.resize(period_ + PATTERN_VECTOR_SIZE_);
+  for (size_t i = 0; i < pattern_.size(); ++i)
+    pattern_[i] = key[i % key_size];
+}
+
+// The kernels consume whole steps of 'step' bytes from 'offset' in the
+// pattern, and return how many bytes they consumed and where they left
+// the offset. 'step' divides the period or is shorter than it, so one
+// subtraction always wraps the offset back in range.
+
+static size_t repkey_xor_words_(unsigned char *out, const unsigned char *in, size_t size,
+                                const unsigned char *pattern, size_t period, size_t *offset) {
+  size_t o = *offset;
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    uint64_t x, k;
+    memcpy(&x, in + i, 8);
+    memcpy(&k, pattern + o, 8);
+    x ^= k;
+    memcpy(out + i, &x, 8);
+
+    o += 8;
+    if (o >= period)
+      o -= period;
+  }
+  *offset = o;
+  return i;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+__attribute__((target("avx2")))
+static size_t repkey_xor_avx2_(unsigned char *out, const unsigned char *in, size_t size,
+                               const unsigned char *pattern, size_t period, size_t *offset) {
+  size_t o = *offset;
+  size_t i = 0;
+  for (; i + 32 <= size; i += 32) {
+    const __m256i x = _mm256_loadu_si256((const __m256i *)(in + i));
+    const __m256i k = _mm256_loadu_si256((const __m256i *)(pattern + o));
+    _mm256_storeu_si256((__m256i *)(out + i), _mm256_xor_si256(x, k));
+
+    o += 32;
+    if (o >= period)
+      o -= period;
+  }
+  *offset = o;
+  return i;
+}
+
+#endif
+
+void RepeatingKeyXor::apply(unsigned char *out, const unsigned char *in, size_t size) {
+  const unsigned char *pattern = (const unsigned char *)pattern_.data();
+
+  size_t done = 0;
+#if defined(__x86_64__) || defined(__i386__)
+  if (simd_level() >= SIMD_AVX2)
+    done = repkey_xor_avx2_(out, in, size, pattern, period_, &offset_);
+#endif
+  done += repkey_xor_words_(out + done, in + done, size - done, pattern, period_, &offset_);
+
+  for (; done < size; ++done) {
+    out[done] = in[done] ^ pattern[offset_];
+    if (++offset_ == period_)
+      offset_ = 0;
+  }
+}
+
+std::string repkey_xor(std::string_view key, std::string_view s) {
+  std::string result(s.size(), '\0');
+  RepeatingKeyXor(key).apply((unsigned char *)&result[0], (const unsigned char *)s.data(),
+                             s.size());
+  return result;
+}
+
+void repkey_xor(std::string_view key, std::string *s) {
+  RepeatingKeyXor(key).apply((unsigned char *)&(*s)[0], (const unsigned char *)s->data(),
+                             s->size());
+}
+
+size_t key_period(std::string_view key) {
+  for (size_t period = 1; period < key.size(); ++period) {
+    if (key.size() % period)
+      continue;
+    // each byte matches the one a period before it
+    if (key.substr(period) == key.substr(0, key.size() - period))
+      return period;
+  }
+  return key.size();
+}
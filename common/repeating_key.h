@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stddef.h>
+#include <string>
+#include <string_view>
+
+// XORs data with a repeating key, a vector at a time. The key is
+// expanded once into a pattern whose period is a multiple of both the
+// key size and the vector size (their lcm, for keys that small), so
+// that every vector of input meets a plain unaligned load of pattern.
+class RepeatingKeyXor {
+ public:
+  // 'key' must not be empty.
+  explicit RepeatingKeyXor(std::string_view key);
+
+  // XORs the 'size' bytes at 'in' into 'out', which may be 'in'. The
+  // key picks up where the previous call left it, so a stream can be
+  // fed in chunks of any size.
+  void apply(unsigned char *out, const unsigned char *in, size_t size);
+  // Starts over from the first key byte.
+  void rewind() {
+    offset_ = 0;
+  }
+
+ private:
+  // the key repeated over 'period_' bytes, plus one vector's worth so
+  // that loads starting anywhere in the period stay inside
+  std::string pattern_;
+  size_t period_;
+  // where the next byte is in the period
+  size_t offset_;
+};
+
+// One-shot helpers: 's' xored with 'key', in a new string or in place.
+std::string repkey_xor(std::string_view key, std::string_view s);
+void repkey_xor(std::string_view key, std::string *s);
+
+// Size of the shortest key 'key' repeats, a divisor of its size: 17
+// for a 34-byte key made of the same 17 bytes twice.
+size_t key_period(std::string_view key);
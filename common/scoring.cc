@@ -0,0 +1,407 @@
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "scoring.h"
+#include "xor_search.h"
+
+// Natural logarithm usable in constant expressions: with x = m * 2^e
+// and m in [1, 2), ln(x) = e * ln(2) + 2 * atanh((m - 1) / (m + 1)).
+static constexpr double constexpr_log_(double x) {
+  int e = 0;
+  while (x >= 2.0) {
+    x /= 2.0;
+    ++e;
+  }
+  while (x < 1.0) {
+    x *= 2.0;
+    --e;
+  }
+
+  const double y = (x - 1.0) / (x + 1.0);
+  double sum = 0.0;
+  double term = y;
+  for (int k = 1; k < 40; k += 2) {
+    sum += term / k;
+    term *= y * y;
+  }
+  return e * 0.69314718055994530942 + 2.0 * sum;
+}
+
+// letter frequencies in English text, in percent
+static constexpr double letter_frequencies_[26] = {
+  8.167, 1.492, 2.782, 4.253, 12.702, 2.228, 2.015, 6.094, 6.966,
+  0.153, 0.772, 4.025, 2.406, 6.749, 7.507, 1.929, 0.095, 5.987,
+  6.327, 9.056, 2.758, 0.978, 2.360, 0.150, 1.974, 0.074,
+};
+
+// Relative weight of each byte in English prose: mostly lower case
+// letters and spaces, some punctuation, and a tiny floor for control
+// and non-ascii bytes so that log-probabilities stay finite.
+static constexpr double english_weight_(const int c) {
+  if (c >= 'a' && c <= 'z')
+    return letter_frequencies_[c - 'a'] * 0.75;
+  if (c >= 'A' && c <= 'Z')
+    return letter_frequencies_[c - 'A'] * 0.03;
+  if (c >= '0' && c <= '9')
+    return 0.1;
+  switch (c) {
+    case ' ': return 18.0;
+    case '.': return 0.6;
+    case ',': return 0.6;
+    case '\n': return 0.5;
+    case '\'': return 0.3;
+    case '"': return 0.2;
+    case '-': return 0.2;
+    case '!': return 0.05;
+    case '?': return 0.05;
+    case ';': return 0.03;
+    case ':': return 0.03;
+    default: break;
+  }
+  if (c >= 0x20 && c < 0x7f)
+    return 0.01;
+  return 1e-6;
+}
+
+struct UnigramTable_ {
+  double logp[256];
+  // 1 / p, for the chi-squared sums
+  double inv_p[256];
+};
+
+static constexpr UnigramTable_ make_unigram_table_() {
+  UnigramTable_ table{};
+
+  double total = 0.0;
+  for (int c = 0; c < 256; ++c)
+    total += english_weight_(c);
+
+  for (int c = 0; c < 256; ++c) {
+    const double p = english_weight_(c) / total;
+    table.logp[c] = constexpr_log_(p);
+    table.inv_p[c] = 1.0 / p;
+  }
+  return table;
+}
+static constexpr UnigramTable_ unigram_table_ = make_unigram_table_();
+
+// The bigram table holds log P(b | a), the log-probability of byte b
+// following byte a, normalized over each row. It comes from joint
+// pair weights p(a) * p(b) * ratio, where the ratio tells how much more
+// (or less) often than independent bytes the pair shows up in English.
+// Ratios go by class: letters regardless of case, space, end-of-phrase
+// punctuation, rest. Letter pairs take them from published bigram
+// frequencies, with what the listed pairs leave spread over the others
+// in proportion to chance; pairs involving space or punctuation use
+// rough ratios.
+static const int BIGRAM_SPACE_ = 26;
+static const int BIGRAM_PUNCT_ = 27;
+static const int BIGRAM_OTHER_ = 28;
+static const int BIGRAM_CLASSES_ = 29;
+
+static constexpr int bigram_class_(const int c) {
+  if (c >= 'a' && c <= 'z')
+    return c - 'a';
+  if (c >= 'A' && c <= 'Z')
+    return c - 'A';
+  if (c == ' ' || c == '\n')
+    return BIGRAM_SPACE_;
+  if (c == '.' || c == ',' || c == ';' || c == ':' || c == '!' || c == '?')
+    return BIGRAM_PUNCT_;
+  return BIGRAM_OTHER_;
+}
+
+struct LetterPair_ {
+  char first;
+  char second;
+  // percent of all letter pairs in English text
+  double frequency;
+};
+
+static constexpr LetterPair_ common_pairs_[] = {
+  {'t', 'h', 3.56}, {'h', 'e', 3.07}, {'i', 'n', 2.43}, {'e', 'r', 2.05},
+  {'a', 'n', 1.99}, {'r', 'e', 1.85}, {'o', 'n', 1.76}, {'a', 't', 1.49},
+  {'e', 'n', 1.45}, {'n', 'd', 1.35}, {'t', 'i', 1.34}, {'e', 's', 1.34},
+  {'o', 'r', 1.28}, {'t', 'e', 1.20}, {'o', 'f', 1.17}, {'e', 'd', 1.17},
+  {'i', 's', 1.13}, {'i', 't', 1.12}, {'a', 'l', 1.09}, {'a', 'r', 1.07},
+  {'s', 't', 1.05}, {'t', 'o', 1.04}, {'n', 't', 1.04}, {'n', 'g', 0.95},
+  {'s', 'e', 0.93}, {'h', 'a', 0.93}, {'a', 's', 0.87}, {'o', 'u', 0.87},
+  {'i', 'o', 0.83}, {'l', 'e', 0.83}, {'v', 'e', 0.83}, {'c', 'o', 0.79},
+  {'m', 'e', 0.79}, {'d', 'e', 0.76}, {'h', 'i', 0.76}, {'r', 'i', 0.73},
+  {'r', 'o', 0.73}, {'i', 'c', 0.70}, {'n', 'e', 0.69}, {'e', 'a', 0.69},
+  {'r', 'a', 0.69}, {'c', 'e', 0.65}, {'l', 'i', 0.62}, {'c', 'h', 0.60},
+  {'l', 'l', 0.58}, {'b', 'e', 0.58}, {'m', 'a', 0.57}, {'s', 'i', 0.55},
+  {'o', 'm', 0.55}, {'u', 'r', 0.54}, {'q', 'u', 0.09},
+};
+
+struct BigramTable_ {
+  float logp[65536];
+};
+
+static constexpr BigramTable_ make_bigram_table_() {
+  // what the listed letter pairs leave to the others, as a ratio to
+  // chance shared by all of them
+  double listed = 0.0, listed_expected = 0.0;
+  for (const LetterPair_ &pair : common_pairs_) {
+    listed += pair.frequency;
+    listed_expected +=
+        letter_frequencies_[pair.first - 'a'] * letter_frequencies_[pair.second - 'a'] / 100.0;
+  }
+  const double other_letters = (100.0 - listed) / (100.0 - listed_expected);
+
+  double ratio[BIGRAM_CLASSES_][BIGRAM_CLASSES_] = {};
+  for (int a = 0; a < BIGRAM_CLASSES_; ++a) {
+    for (int b = 0; b < BIGRAM_CLASSES_; ++b) {
+      double r = 1.0;
+      if (a < 26 && b < 26)
+        r = other_letters;
+      else if (a == BIGRAM_SPACE_ && b == BIGRAM_SPACE_)
+        r = 0.1;
+      else if (a == BIGRAM_PUNCT_ && b == BIGRAM_SPACE_)
+        r = 4.0;
+      else if (a == BIGRAM_SPACE_ && b == BIGRAM_PUNCT_)
+        r = 0.1;
+      else if (a == BIGRAM_PUNCT_ && b < 26)
+        r = 0.2;
+      ratio[a][b] = r;
+    }
+  }
+  for (const LetterPair_ &pair : common_pairs_) {
+    const int a = pair.first - 'a';
+    const int b = pair.second - 'a';
+    const double expected = letter_frequencies_[a] * letter_frequencies_[b] / 100.0;
+    ratio[a][b] = pair.frequency / expected;
+  }
+
+  // the row of a only depends on its class: sum p(b) * ratio over b
+  // once per class, then take the logs
+  double log_ratio[BIGRAM_CLASSES_][BIGRAM_CLASSES_] = {};
+  double log_row[BIGRAM_CLASSES_] = {};
+  for (int a = 0; a < BIGRAM_CLASSES_; ++a) {
+    double row = 0.0;
+    for (int b = 0; b < 256; ++b)
+      row += ratio[a][bigram_class_(b)] / unigram_table_.inv_p[b];
+    log_row[a] = constexpr_log_(row);
+    for (int b = 0; b < BIGRAM_CLASSES_; ++b)
+      log_ratio[a][b] = constexpr_log_(ratio[a][b]);
+  }
+
+  BigramTable_ table{};
+  for (int a = 0; a < 256; ++a) {
+    const int class_a = bigram_class_(a);
+    for (int b = 0; b < 256; ++b) {
+      table.logp[(a << 8) | b] = unigram_table_.logp[b] +
+          log_ratio[class_a][bigram_class_(b)] - log_row[class_a];
+    }
+  }
+  return table;
+}
+static constexpr BigramTable_ bigram_table_ = make_bigram_table_();
+
+// The original heuristic, as a table sum: invalid bytes are worth so
+// much less than nothing that any of them makes the total negative.
+class ClassicScorer_ : public TextScorer {
+ public:
+  ClassicScorer_() {
+    for (int c = 0; c < 256; ++c) {
+      if (c >= 0x80 || !(isprint(c) || isspace(c))) {
+        points_[c] = -(1 << 30);
+        continue;
+      }
+
+      points_[c] = 1; // 1 base point
+      if (isalpha(c) || c == ' ')
+        ++points_[c];
+      if (isalpha(c) && strchr("etaoi", tolower(c)))
+        ++points_[c];
+    }
+  }
+
+  void score_masks(const StridedView &ciphertext, double scores[256]) const override {
+    const ByteHistogram histogram(ciphertext);
+    for (int mask = 0; mask < 256; ++mask) {
+      int64_t score = 0;
+      for (int i = 0; i < histogram.present_count_; ++i) {
+        const unsigned char b = histogram.present_[i];
+        score += (int64_t)histogram.count_[b] * points_[b ^ mask];
+      }
+      scores[mask] = finish_(score);
+    }
+  }
+
+  double score(std::string_view plaintext) const override {
+    int64_t score = 0;
+    for (const unsigned char c : plaintext)
+      score += points_[c];
+    return finish_(score);
+  }
+
+  double text_threshold() const override {
+    // any text made of valid bytes
+    return 0;
+  }
+
+ private:
+  static double finish_(int64_t score) {
+    return score > 0 ? score : SCORE_INVALID;
+  }
+
+  int points_[256];
+};
+
+class ChiSquaredScorer_ : public TextScorer {
+ public:
+  // With observed counts o and expected counts e = n * p, summing
+  // (o - e)^2 / e over all bytes boils down to sum(o^2 / p) / n - n.
+  void score_masks(const StridedView &ciphertext, double scores[256]) const override {
+    const ByteHistogram histogram(ciphertext);
+    const double n = histogram.total_;
+    for (int mask = 0; mask < 256; ++mask) {
+      double sum = 0.0;
+      for (int i = 0; i < histogram.present_count_; ++i) {
+        const unsigned char b = histogram.present_[i];
+        const double count = histogram.count_[b];
+        sum += count * count * unigram_table_.inv_p[b ^ mask];
+      }
+      scores[mask] = n ? -(sum / n - n) / n : 0.0;
+    }
+  }
+
+  double score(std::string_view plaintext) const override {
+    double scores[256];
+    score_masks(plaintext, scores);
+    return scores[0];
+  }
+
+  double text_threshold() const override {
+    return -10.0;
+  }
+};
+
+class LogLikelihoodScorer_ : public TextScorer {
+ public:
+  void score_masks(const StridedView &ciphertext, double scores[256]) const override {
+    const ByteHistogram histogram(ciphertext);
+    const double n = histogram.total_;
+    for (int mask = 0; mask < 256; ++mask) {
+      double sum = 0.0;
+      for (int i = 0; i < histogram.present_count_; ++i) {
+        const unsigned char b = histogram.present_[i];
+        sum += histogram.count_[b] * unigram_table_.logp[b ^ mask];
+      }
+      scores[mask] = n ? sum / n : 0.0;
+    }
+  }
+
+  double score(std::string_view plaintext) const override {
+    double sum = 0.0;
+    for (const unsigned char c : plaintext)
+      sum += unigram_table_.logp[c];
+    return plaintext.empty() ? 0.0 : sum / plaintext.size();
+  }
+
+  double text_threshold() const override {
+    return -4.5;
+  }
+};
+
+class BigramScorer_ : public TextScorer {
+ public:
+  // XORing both bytes of a pair with 'mask' is XORing its 16-bit index
+  // with 'mask' * 0x0101, so each distinct pair is one lookup per mask.
+  // Pairs are counted in a table kept per thread, and only the entries
+  // used are cleared afterwards.
+  void score_masks(const StridedView &ciphertext, double scores[256]) const override {
+    const size_t size = ciphertext.size();
+    if (size < 2) {
+      unigram_.score_masks(ciphertext, scores);
+      return;
+    }
+
+    static thread_local std::vector<uint32_t> counts(65536, 0);
+    static thread_local std::vector<uint16_t> distinct;
+    distinct.clear();
+    for (size_t i = 0; i + 1 < size; ++i) {
+      const uint16_t pair = (ciphertext[i] << 8) | ciphertext[i + 1];
+      if (!counts[pair]++)
+        distinct.push_back(pair);
+    }
+
+    for (int mask = 0; mask < 256; ++mask) {
+      const uint16_t mask2 = mask * 0x0101;
+      double sum = 0.0;
+      for (const uint16_t pair : distinct)
+        sum += counts[pair] * bigram_table_.logp[pair ^ mask2];
+      scores[mask] = sum / (size - 1);
+    }
+
+    for (const uint16_t pair : distinct)
+      counts[pair] = 0;
+  }
+
+  double score(std::string_view plaintext) const override {
+    const size_t size = plaintext.size();
+    if (size < 2)
+      return unigram_.score(plaintext);
+
+    const unsigned char *p = (const unsigned char *)plaintext.data();
+    double sum = 0.0;
+    for (size_t i = 0; i + 1 < size; ++i)
+      sum += bigram_table_.logp[(p[i] << 8) | p[i + 1]];
+    return sum / (size - 1);
+  }
+
+  double text_threshold() const override {
+    return -5.5;
+  }
+
+ private:
+  LogLikelihoodScorer_ unigram_;
+};
+
+const TextScorer &text_scorer(const ScoringModel model) {
+  static const ClassicScorer_ classic;
+  static const ChiSquaredScorer_ chi_squared;
+  static const LogLikelihoodScorer_ log_likelihood;
+  static const BigramScorer_ bigram;
+
+  switch (model) {
+    case SCORING_CLASSIC:
+      return classic;
+    case SCORING_CHI_SQUARED:
+      return chi_squared;
+    case SCORING_BIGRAM:
+      return bigram;
+    case SCORING_LOG_LIKELIHOOD:
+    default:
+      return log_likelihood;
+  }
+}
+
+int parse_scoring_model(const char *name, ScoringModel *model) {
+  if (!strcmp(name, "classic")) {
+    *model = SCORING_CLASSIC;
+  } else if (!strcmp(name, "chi2")) {
+    *model = SCORING_CHI_SQUARED;
+  } else if (!strcmp(name, "unigram")) {
+    *model = SCORING_LOG_LIKELIHOOD;
+  } else if (!strcmp(name, "bigram")) {
+    *model = SCORING_BIGRAM;
+  } else {
+    return -1;
+  }
+  return 0;
+}
+
+ScoringModel default_scoring_model() {
+  ScoringModel model = SCORING_LOG_LIKELIHOOD;
+
+  const char *name = getenv("CRYPTOPALS_SCORING");
+  if (name && parse_scoring_model(name, &model) < 0)
+    fprintf(stderr, "%s: ignoring unknown CRYPTOPALS_SCORING [%s]\n",
+            __FUNCTION__, name);
+  return model;
+}
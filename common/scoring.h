@@ -0,0 +1,50 @@
+#pragma once
+
+#include <math.h>
+#include <string_view>
+#include "strided_view.h"
+
+// Models used to tell how much a candidate plaintext looks like
+// English text.
+enum ScoringModel {
+  // 1 point per byte, 1 more per letter or space and 2 more per e, t,
+  // a, o or i; anything neither printable nor space rules the text
+  // out. Scores are not normalized, longer texts score higher.
+  SCORING_CLASSIC = 0,
+  // minus the chi-squared distance between the byte counts and those
+  // expected from English text, per byte
+  SCORING_CHI_SQUARED,
+  // log-likelihood of the bytes under an English unigram model, per
+  // byte
+  SCORING_LOG_LIKELIHOOD,
+  // log-likelihood of each byte given the one before it, under an
+  // English bigram model, per pair; only meaningful on contiguous text
+  SCORING_BIGRAM,
+};
+
+// marks masks or texts a model rules out entirely
+static const double SCORE_INVALID = -HUGE_VAL;
+
+class TextScorer {
+ public:
+  virtual ~TextScorer() {}
+
+  // Scores 'ciphertext' xored with each of the 256 masks, taking it as
+  // contiguous text; higher is better. Strings convert to views, and
+  // strided views let a column be scored in place.
+  virtual void score_masks(const StridedView &ciphertext, double scores[256]) const = 0;
+  // Scores a candidate plaintext, on the same scale.
+  virtual double score(std::string_view plaintext) const = 0;
+  // Scores at or above this are confidently English text.
+  virtual double text_threshold() const = 0;
+};
+
+const TextScorer &text_scorer(const ScoringModel model);
+
+// Parses "classic", "chi2", "unigram" or "bigram". Returns 0 on
+// success, -1 on unknown names.
+int parse_scoring_model(const char *name, ScoringModel *model);
+
+// The model named by CRYPTOPALS_SCORING in the environment, or the
+// unigram log-likelihood one if unset.
+ScoringModel default_scoring_model();
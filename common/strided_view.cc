@@ -0,0 +1,49 @@
+#include "strided_view.h"
+
+// rows copied at a time by transpose_columns(), so that the rows read
+// and the tails of the columns written all stay in L1
+static const size_t TRANSPOSE_BLOCK_BYTES_ = 16 * 1024;
+
+StridedView column_view(std::string_view s, size_t stride, size_t column) {
+  const size_t size = s.size();
+  const size_t length = column < size ? (size - column + stride - 1) / stride : 0;
+  return StridedView((const unsigned char *)s.data(), stride, column, length);
+}
+
+void transpose_columns(std::string_view s, size_t stride, std::string *arena,
+                       std::vector<StridedView> *columns) {
+  const size_t size = s.size();
+  arena->resize(size);
+  unsigned char *out = (unsigned char *)&(*arena)[0];
+  const unsigned char *in = (const unsigned char *)s.data();
+
+  // the first size % stride columns have one more byte than the others
+  const size_t rows = size / stride;
+  const size_t long_columns = size % stride;
+  std::vector<size_t> starts(stride);
+  columns->clear();
+  size_t start = 0;
+  for (size_t column = 0; column < stride; ++column) {
+    const size_t length = rows + (column < long_columns);
+    starts[column] = start;
+    columns->push_back(StridedView(out, 1, start, length));
+    start += length;
+  }
+
+  size_t block_rows = TRANSPOSE_BLOCK_BYTES_ / stride;
+  if (!block_rows)
+    block_rows = 1;
+  for (size_t first = 0; first < rows; first += block_rows) {
+    const size_t last = first + block_rows < rows ? first + block_rows : rows;
+    for (size_t column = 0; column < stride; ++column) {
+      unsigned char *dst = out + starts[column];
+      const unsigned char *src = in + column;
+      for (size_t row = first; row < last; ++row)
+        dst[row] = src[row * stride];
+    }
+  }
+
+  // the short last row
+  for (size_t column = 0; column < long_columns; ++column)
+    out[starts[column] + rows] = in[rows * stride + column];
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stddef.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Every 'stride_'-th byte of a buffer, starting at 'offset_', and
+// 'length_' of them: a column of the buffer cut in rows of 'stride_'
+// bytes, seen without copying it. Contiguous buffers convert to views
+// with a stride of 1.
+class StridedView {
+ public:
+  StridedView() : base_(NULL), stride_(1), offset_(0), length_(0) {}
+  StridedView(const unsigned char *base, size_t stride, size_t offset, size_t length)
+      : base_(base), stride_(stride), offset_(offset), length_(length) {}
+  StridedView(std::string_view s)
+      : base_((const unsigned char *)s.data()), stride_(1), offset_(0), length_(s.size()) {}
+  StridedView(const std::string &s)
+      : StridedView(std::string_view(s)) {}
+
+  unsigned char operator[](size_t i) const {
+    return base_[offset_ + i * stride_];
+  }
+  size_t size() const {
+    return length_;
+  }
+  bool empty() const {
+    return !length_;
+  }
+  bool contiguous() const {
+    return stride_ == 1;
+  }
+
+  const unsigned char *base_;
+  size_t stride_;
+  size_t offset_;
+  size_t length_;
+};
+
+// Column 'column' of 's' cut in rows of 'stride' bytes; the last row
+// may be short, so later columns may be one byte shorter.
+StridedView column_view(std::string_view s, size_t stride, size_t column);
+
+// Copies all the columns of 's' cut in rows of 'stride' bytes one
+// after the other into 'arena', and stores contiguous views of them in
+// 'columns'. Worth it on inputs too large for the cache, where walking
+// each column on its own would stream the whole input once per column:
+// this reads it once, a few rows at a time.
+void transpose_columns(std::string_view s, size_t stride, std::string *arena,
+                       std::vector<StridedView> *columns);
@@ -0,0 +1,104 @@
+#include "thread_pool.h"
+
+// pool and index of the worker running on this thread, if any
+static thread_local const ThreadPool *current_pool_ = NULL;
+static thread_local size_t current_worker_ = 0;
+
+ThreadPool::ThreadPool(size_t threads_count)
+    : queued_(0), pending_(0), next_worker_(0), stopping_(false) {
+  if (!threads_count)
+    threads_count = std::thread::hardware_concurrency();
+  if (!threads_count)
+    threads_count = 1;
+
+  for (size_t i = 0; i < threads_count; ++i)
+    workers_.emplace_back(new Worker());
+  for (size_t i = 0; i < threads_count; ++i)
+    threads_.emplace_back(&ThreadPool::run_, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+  wait();
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  work_cv_.notify_all();
+  for (std::thread &t : threads_)
+    t.join();
+}
+
+void ThreadPool::submit(Task task) {
+  pending_.fetch_add(1);
+  {
+    // taking the lock orders this against a worker about to sleep
+    std::lock_guard<std::mutex> lock(mutex_);
+    queued_.fetch_add(1);
+  }
+
+  if (current_pool_ == this) {
+    // nested task: keep it close
+    Worker &worker = *workers_[current_worker_];
+    std::lock_guard<std::mutex> lock(worker.mutex_);
+    worker.tasks_.push_front(std::move(task));
+  } else {
+    Worker &worker = *workers_[next_worker_.fetch_add(1) % workers_.size()];
+    std::lock_guard<std::mutex> lock(worker.mutex_);
+    worker.tasks_.push_back(std::move(task));
+  }
+  work_cv_.notify_one();
+}
+
+void ThreadPool::wait() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_cv_.wait(lock, [this] { return pending_.load() == 0; });
+}
+
+// Takes the next task from our own queue, or steals one from the
+// others; returns false if every queue is empty.
+bool ThreadPool::take_(size_t self, Task *task) {
+  const size_t count = workers_.size();
+  for (size_t i = 0; i < count; ++i) {
+    Worker &worker = *workers_[(self + i) % count];
+    std::lock_guard<std::mutex> lock(worker.mutex_);
+    if (worker.tasks_.empty())
+      continue;
+
+    if (!i) {
+      *task = std::move(worker.tasks_.front());
+      worker.tasks_.pop_front();
+    } else {
+      *task = std::move(worker.tasks_.back());
+      worker.tasks_.pop_back();
+    }
+    queued_.fetch_sub(1);
+    return true;
+  }
+
+  return false;
+}
+
+void ThreadPool::run_(size_t self) {
+  current_pool_ = this;
+  current_worker_ = self;
+
+  Task task;
+  while (true) {
+    if (!take_(self, &task)) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      work_cv_.wait(lock, [this] { return queued_.load() || stopping_; });
+      if (!queued_.load() && stopping_)
+        break;
+      continue;
+    }
+
+    task();
+    task = nullptr;
+
+    if (pending_.fetch_sub(1) == 1) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      done_cv_.notify_all();
+    }
+  }
+}
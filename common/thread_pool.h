@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stddef.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads, each with its own queue of tasks.
+// Tasks submitted from a worker go to the front of that worker's
+// queue, so nested work runs depth-first and stays hot in its cache;
+// an idle worker steals from the back of the others' queues.
+class ThreadPool {
+ public:
+  typedef std::function<void()> Task;
+
+  // 0 threads means one per core.
+  explicit ThreadPool(size_t threads_count = 0);
+  // Waits for the queued tasks, then stops the workers.
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  void submit(Task task);
+  // Blocks until every task submitted so far, and every task those
+  // submitted in turn, has run.
+  void wait();
+
+  size_t threads_count() const {
+    return threads_.size();
+  }
+
+ private:
+  class Worker {
+   public:
+    std::mutex mutex_;
+    std::deque<Task> tasks_;
+  };
+
+  bool take_(size_t self, Task *task);
+  void run_(size_t self);
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::vector<std::thread> threads_;
+
+  std::mutex mutex_;
+  // signalled when tasks are queued or the pool stops
+  std::condition_variable work_cv_;
+  // signalled when the last pending task is done
+  std::condition_variable done_cv_;
+  // tasks queued but not taken yet, and tasks not finished yet
+  std::atomic<size_t> queued_;
+  std::atomic<size_t> pending_;
+  std::atomic<size_t> next_worker_;
+  bool stopping_;
+};
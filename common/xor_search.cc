@@ -0,0 +1,159 @@
+#include <ctype.h>
+#include <string.h>
+#include <algorithm>
+#include "scoring.h"
+#include "xor_search.h"
+
+ByteHistogram::ByteHistogram(const StridedView &s)
+    : total_(s.size()), present_count_(0) {
+  // four interleaved tables, so that runs of the same byte do not
+  // stall on a single counter
+  uint32_t counts[4][256];
+  memset(counts, 0, sizeof(counts));
+
+  const unsigned char *p = s.base_ + s.offset_;
+  const size_t stride = s.stride_;
+  const size_t size = s.size();
+  size_t i = 0;
+  if (s.contiguous()) {
+    for (; i + 4 <= size; i += 4) {
+      ++counts[0][p[i]];
+      ++counts[1][p[i + 1]];
+      ++counts[2][p[i + 2]];
+      ++counts[3][p[i + 3]];
+    }
+  } else {
+    for (const unsigned char *q = p; i + 4 <= size; i += 4, q += 4 * stride) {
+      ++counts[0][q[0]];
+      ++counts[1][q[stride]];
+      ++counts[2][q[2 * stride]];
+      ++counts[3][q[3 * stride]];
+    }
+  }
+  for (; i < size; ++i)
+    ++counts[0][p[i * stride]];
+
+  for (int b = 0; b < 256; ++b) {
+    count_[b] = counts[0][b] + counts[1][b] + counts[2][b] + counts[3][b];
+    if (count_[b])
+      present_[present_count_++] = b;
+  }
+}
+
+int best_masks(const double scores[256], const int k, MaskCandidate *candidates) {
+  // Used as the 'less' of the heap functions, this keeps the worst of
+  // the candidates at the top, which is the one to evict when a better
+  // one comes along.
+  const BetterMaskComparator better;
+
+  int count = 0;
+  // avoid xoring with 0
+  for (int mask = 0x01; mask <= 0xff; ++mask) {
+    if (scores[mask] == SCORE_INVALID)
+      continue;
+
+    const MaskCandidate candidate(mask, scores[mask]);
+    if (count < k) {
+      candidates[count++] = candidate;
+      std::push_heap(candidates, candidates + count, better);
+    } else if (count && better(candidate, candidates[0])) {
+      std::pop_heap(candidates, candidates + count, better);
+      candidates[count - 1] = candidate;
+      std::push_heap(candidates, candidates + count, better);
+    }
+  }
+
+  std::sort_heap(candidates, candidates + count, better);
+  return count;
+}
+
+int best_mask(const double scores[256], double *score) {
+  MaskCandidate best;
+  if (!best_masks(scores, 1, &best)) {
+    *score = SCORE_INVALID;
+    return -1;
+  }
+
+  *score = best.score_;
+  return best.mask_;
+}
+
+int top_xors(const StridedView &buf, const TextScorer &scorer, const int k,
+             MaskCandidate *candidates) {
+  double scores[256];
+  scorer.score_masks(buf, scores);
+
+  return best_masks(scores, k, candidates);
+}
+
+std::string xor_one(const StridedView &buf, int int_mask) {
+  std::string result(buf.size(), '\0');
+
+  unsigned char mask = int_mask & 0x000000ff;
+  const size_t size = result.size();
+  for (size_t i = 0; i < size; ++i) {
+    result[i] = buf[i] ^ mask;
+  }
+
+  return result;
+}
+
+static bool is_valid_(int c) {
+  return isprint(c) || isspace(c);
+}
+
+int compute_frequencies(std::string_view s, std::vector<int> *frequencies) {
+  bool has_nonprint = false;
+
+  for (const unsigned char c: s) {
+    ++(*frequencies)[c];
+    if (!is_valid_(c))
+      has_nonprint = true;
+  }
+
+  if (has_nonprint)
+    // score is 0 if non-print chars are present
+    return 0;
+
+  // try and compute a reasonable score; give 1 base point to all
+  // chars, then 1 additional point for all letters or spaces, and 1
+  // other additional point for the 5 more common letters in english
+  // text (e, t, a, o, i)
+  int score = s.size(); // 1 base point
+  // ascii is 7 bits
+  for (unsigned char c = 0; c < 0x7f; ++c) {
+    if (!isalpha(c) && c != ' ')
+      continue;
+
+    switch (tolower(c)) {
+      case 'e':
+      case 't':
+      case 'a':
+      case 'o':
+      case 'i':
+        // 2 extra points
+        score += (*frequencies)[c] * 2;
+        break;
+
+      default:
+        // 1 extra point
+        score += (*frequencies)[c];
+        break;
+    }
+  }
+  return score;
+}
+
+void print_frequencies(FILE *out, const std::vector<int> &frequencies) {
+  for (unsigned int i = 0; i < frequencies.size(); ++i) {
+    if (!frequencies[i])
+      continue;
+
+    fprintf(out, "  %d (", i);
+    if (isprint(i))
+      fprintf(out, "%c", i);
+    else
+      fprintf(out, "nonprint");
+    fprintf(out, "): %d times\n", frequencies[i]);
+  }
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "strided_view.h"
+
+class TextScorer;
+
+// Counts of each byte value in a buffer. XORing the buffer with a
+// single byte only permutes the counts, so one histogram is enough to
+// score every mask (see TextScorer::score_masks()).
+class ByteHistogram {
+ public:
+  explicit ByteHistogram(const StridedView &s);
+
+  uint32_t count_[256];
+  size_t total_;
+  // byte values with a non-zero count, so that scoring can skip the rest
+  unsigned char present_[256];
+  int present_count_;
+};
+
+class MaskCandidate {
+ public:
+  MaskCandidate() : mask_(0), score_(0) {}
+  MaskCandidate(int mask, double score) : mask_(mask), score_(score) {}
+
+  int mask_;
+  double score_;
+};
+class BetterMaskComparator {
+ public:
+  bool operator() (const MaskCandidate &lhs, const MaskCandidate &rhs) const {
+    // higher scores first, lower masks first on ties
+    if (lhs.score_ != rhs.score_)
+      return lhs.score_ > rhs.score_;
+    return lhs.mask_ < rhs.mask_;
+  }
+};
+
+// Stores the (up to) 'k' best masks in 1..255 in 'candidates', best
+// first, leaving out the ones the scorer ruled out; returns how many
+// it stored. 'candidates' is used as a fixed-size heap while scanning,
+// so nothing is allocated.
+int best_masks(const double scores[256], const int k, MaskCandidate *candidates);
+
+// Returns the mask in 1..255 with the highest score (the lowest one on
+// ties) and stores its score, or returns -1 if the scorer ruled them
+// all out.
+int best_mask(const double scores[256], double *score);
+
+// Stores the 'k' best masks for 'buf' under 'scorer' in 'candidates',
+// best first; returns how many there are.
+int top_xors(const StridedView &buf, const TextScorer &scorer, const int k,
+             MaskCandidate *candidates);
+
+// Returns 'buf' xored with the low byte of 'mask'.
+std::string xor_one(const StridedView &buf, int mask);
+
+// Counts each byte of 's' in 'frequencies' (256 entries), and returns
+// a rough score: 0 if a char is neither printable nor a space, else 1
+// point per char, 1 more per letter or space, and 1 more again for
+// each of e, t, a, o and i.
+int compute_frequencies(std::string_view s, std::vector<int> *frequencies);
+
+// Prints the non-zero counts of 'frequencies' to 'out'.
+void print_frequencies(FILE *out, const std::vector<int> &frequencies);
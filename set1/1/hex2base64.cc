@@ -1,70 +1,42 @@
 #include <stdio.h>
-#include <stdlib.h>
+#include "../../common/base64.h"
+#include "../../common/hex.h"
 
-unsigned char get_one(const bool eof_is_error) {
-  int c = getchar();
-  if (c == EOF) {
-    if (eof_is_error) {
-      fprintf(stderr, "Unexpected EOF\n");
-      exit(1);
-    } else {
-      exit(0);
-    }
-  }
-  return c;
-}
-
-int char2int(unsigned char c) {
-  if (c >= '0' && c <= '9')
-    return c - '0';
-  if (c >= 'a' && c <= 'f')
-    return c - 'a' + 10;
-
-  fprintf(stderr, "%s: unexpected char %d\n", __FUNCTION__, c);
-  exit(1);
-}
-
-unsigned char get_one_hex(const bool eof_is_error) {
-  unsigned char x1 = get_one(eof_is_error);
-  unsigned char x2 = get_one(true);
-
-  int hi = char2int(x1);
-  int lo = char2int(x2);
-
-  return (((hi & 0x0f) << 4) | (lo & 0x0f));
-}
-
-void printbase64(unsigned char c) {
-  if (c <= 25)
-    fprintf(stdout, "%c", c + 'A');
-  else if (c <= 51)
-    fprintf(stdout, "%c", c - 26 + 'a');
-  else if (c <= 61)
-    fprintf(stdout, "%c", c - 52 + '0');
-  else if (c == 62)
-    fprintf(stdout, "+");
-  else if (c == 63)
-    fprintf(stdout, "/");
-  else
-    fprintf(stderr, "%s: unexpected char %d\n", __FUNCTION__, c);
-}
-
-void hex2base64(unsigned char c1, unsigned char c2, unsigned char c3) {
-  printbase64(c1 >> 2);
-  printbase64(((c1 & 0x03) << 4) | (c2 >> 4));
-  printbase64(((c2 & 0x0f) << 2) | (c3 >> 6));
-  printbase64(c3 & 0x3f);
-}
+// bytes converted per block; a multiple of 3, so that only the last
+// block can need padding
+static const size_t BLOCK_SIZE = 3 * 16384;
 
 int main (void) {
-  unsigned char c1, c2, c3;
+  static char hex[2 * BLOCK_SIZE];
+  static unsigned char bin[BLOCK_SIZE];
+  static char out[BLOCK_SIZE / 3 * 4];
 
   while (true) {
-    c1 = get_one_hex(false);
-    c2 = get_one_hex(true);
-    c3 = get_one_hex(true);
+    size_t got = fread(hex, 1, sizeof(hex), stdin);
+    const bool last = got < sizeof(hex);
+    if (last && got && hex[got - 1] == '\n')
+      // ignore the trailing newline
+      --got;
+
+    if (hex_decode(bin, hex, got) < 0) {
+      fprintf(stderr, "Bad hex input\n");
+      return 1;
+    }
+
+    // one write per block
+    const size_t encoded = base64_encode(out, bin, got / 2);
+    if (fwrite(out, 1, encoded, stdout) != encoded) {
+      fprintf(stderr, "Write error\n");
+      return 1;
+    }
+
+    if (last)
+      break;
+  }
 
-    hex2base64(c1, c2, c3);
+  if (ferror(stdin)) {
+    fprintf(stderr, "Read error\n");
+    return 1;
   }
 
   return 0;
@@ -1,67 +1,149 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <string_view>
+#include "../../common/fixed_xor.h"
+#include "../../common/hex.h"
+#include "../../common/input.h"
+#include "../../common/thread_pool.h"
+
+// bytes xored per job; each round of output hands one job to each
+// thread, then writes what they produced
+static const size_t JOB_SIZE = 1 << 20;
+// inputs shorter than this are xored on the main thread
+static const size_t THREADED_MIN_SIZE = 64 << 20;
+// bytes decoded at a time from hex inputs
+static const size_t HEX_BLOCK_SIZE = 4096;
+
+// Xors 'size' bytes of both inputs from byte 'start' into 'out', in
+// the same format as the inputs. Returns 0 on success, -1 on bad hex.
+int xor_range(std::string_view left, std::string_view right, const bool hex,
+              const size_t start, const size_t size, char *out) {
+  if (!hex) {
+    xor_bytes((unsigned char *)out, (const unsigned char *)left.data() + start,
+              (const unsigned char *)right.data() + start, size);
+    return 0;
+  }
+
+  unsigned char left_block[HEX_BLOCK_SIZE], right_block[HEX_BLOCK_SIZE];
+  for (size_t done = 0; done < size; done += HEX_BLOCK_SIZE) {
+    const size_t block = size - done < HEX_BLOCK_SIZE ? size - done : HEX_BLOCK_SIZE;
+    const size_t offset = 2 * (start + done);
+    if (hex_decode(left_block, left.data() + offset, 2 * block) < 0 ||
+        hex_decode(right_block, right.data() + offset, 2 * block) < 0)
+      return -1;
 
-int char2int(unsigned char c) {
-  if (c >= '0' && c <= '9')
-    return c - '0';
-  if (c >= 'a' && c <= 'f')
-    return c - 'a' + 10;
+    xor_bytes(left_block, left_block, right_block, block);
+    hex_encode(out + 2 * done, left_block, block);
+  }
 
-  fprintf(stderr, "%s: unexpected char %d\n", __FUNCTION__, c);
-  exit(1);
+  return 0;
 }
 
-void fixed_xor_and_print(unsigned char left, unsigned char right) {
-  int i1 = char2int(left);
-  int i2 = char2int(right);
+int fixed_xor_and_print(std::string_view left, std::string_view right, const bool hex) {
+  const size_t digits = hex ? 2 : 1;
+  const size_t size = (left.size() < right.size() ? left.size() : right.size()) / digits;
 
-  printf("%x", i1 ^ i2);
-}
+  std::unique_ptr<ThreadPool> pool;
+  size_t jobs_per_round = 1;
+  if (size >= THREADED_MIN_SIZE) {
+    pool.reset(new ThreadPool());
+    jobs_per_round = pool->threads_count();
+  }
+
+  std::string out(jobs_per_round * JOB_SIZE * digits, '\0');
+  std::atomic<bool> failed(false);
+  for (size_t round = 0; round < size; round += jobs_per_round * JOB_SIZE) {
+    size_t round_size = 0;
+    for (size_t job = 0; job < jobs_per_round && round + round_size < size; ++job) {
+      const size_t start = round + round_size;
+      const size_t job_size = size - start < JOB_SIZE ? size - start : JOB_SIZE;
+      char *job_out = &out[round_size * digits];
+      round_size += job_size;
+
+      if (!pool) {
+        if (xor_range(left, right, hex, start, job_size, job_out) < 0)
+          failed = true;
+        continue;
+      }
+      pool->submit([left, right, hex, start, job_size, job_out, &failed] {
+          if (xor_range(left, right, hex, start, job_size, job_out) < 0)
+            failed = true;
+        });
+    }
+    if (pool)
+      pool->wait();
+
+    if (failed) {
+      fprintf(stderr, "Bad hex input\n");
+      return -1;
+    }
+    if (fwrite(out.data(), 1, round_size * digits, stdout) != round_size * digits) {
+      fprintf(stderr, "Write error\n");
+      return -1;
+    }
+  }
 
-void fixed_xor_loop(FILE *fp1, FILE *fp2) {
-  int left, right;
+  return 0;
+}
 
-  while (true) {
-    left = fgetc(fp1);
-    right = fgetc(fp2);
+int fixed_xor_loop(const InputBuffer &input1, const InputBuffer &input2, const bool hex) {
+  std::string_view left = input1.view(), right = input2.view();
 
-    if (left == EOF && right == EOF)
-      // all done
-      return;
+  if (hex) {
+    // ignore a trailing newline
+    if (!left.empty() && left.back() == '\n')
+      left.remove_suffix(1);
+    if (!right.empty() && right.back() == '\n')
+      right.remove_suffix(1);
 
-    if (left == EOF || right == EOF) {
-      fprintf(stderr, "\nOne of the two inputs is longer\n");
-      return;
+    if (left.size() % 2 || right.size() % 2) {
+      fprintf(stderr, "Bad hex input: odd number of digits\n");
+      return 1;
     }
+  }
 
-    fixed_xor_and_print(left, right);
+  if (fixed_xor_and_print(left, right, hex) < 0)
+    return 1;
+
+  if (left.size() != right.size()) {
+    fprintf(stderr, "\nOne of the two inputs is longer\n");
+    return 1;
   }
+
+  return 0;
 }
 
 int main (int argc, char *argv[]) {
-  FILE *fp1, *fp2;
+  InputBuffer input1, input2;
+
+  // fixedxor.bin [--raw] FILE1 FILE2: hex in and out by default, raw
+  // bytes in and out with --raw
+  bool hex = true;
+  if (argc == 4 && !strcmp(argv[1], "--raw")) {
+    hex = false;
+    ++argv;
+    --argc;
+  }
 
   if (argc != 3) {
     fprintf(stderr, "Need 2 arguments, got %d instead\n", argc - 1);
+    fprintf(stderr, "Usage: %s [--raw] FILE1 FILE2\n", argv[0]);
     return 1;
   }
 
-  fp1 = fopen(argv[1], "r");
-  if (!fp1) {
+  if (input1.load(argv[1]) < 0) {
     fprintf(stderr, "Cannot open first file: %s\n", argv[1]);
     return 1;
   }
 
-  fp2 = fopen(argv[2], "r");
-  if (!fp2) {
+  if (input2.load(argv[2]) < 0) {
     fprintf(stderr, "Cannot open second file: %s\n", argv[2]);
     return 1;
   }
 
-  fixed_xor_loop(fp1, fp2);
-
-  fclose(fp1);
-  fclose(fp2);
-
-  return 0;
+  return fixed_xor_loop(input1, input2, hex);
 }
@@ -1,10 +1,8 @@
 #!/bin/bash
 
-while read line; do
-  if ! echo -n "$line" | ./xorcipher.bin &> /dev/null; then
-    # quietly skip lines with no results
-    continue
-  fi
-  echo "Trying for: $line"
-  echo -n "$line" | ./xorcipher.bin
-done < input
+# score every line of the input in one go, and show the best candidates;
+# usage: find_xor.sh [BUILD_DIR], the CMake build tree (../../build by
+# default, from this directory)
+here=$(dirname "$0")
+build_dir=${1:-$here/../../build}
+"$build_dir/set1/4/xorcipher.bin" --batch "$here/input" 5
@@ -1,186 +1,218 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <queue>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <vector>
+#include "../../common/hex.h"
+#include "../../common/input.h"
+#include "../../common/scoring.h"
+#include "../../common/xor_search.h"
 
-bool is_valid(int c) {
-  return isprint(c) || isspace(c);
-}
-
-int get_one_v2(const bool eof_is_error) {
-  int c = getchar();
-  if (c == EOF) {
-    if (eof_is_error) {
-      fprintf(stderr, "Unexpected EOF\n");
-      exit(1);
-    } else {
-      return -1;
-    }
-  }
-  return c;
-}
-
-int char2int(int c) {
-  if (c >= '0' && c <= '9')
-    return c - '0';
-  if (c >= 'a' && c <= 'f')
-    return c - 'a' + 10;
-
-  fprintf(stderr, "%s: unexpected char %d\n", __FUNCTION__, c);
-  exit(1);
-}
+int try_all_xors(std::string_view buf) {
+  double scores[256];
+  text_scorer(default_scoring_model()).score_masks(buf, scores);
 
-int get_one_hex_v2() {
-  int x1 = get_one_v2(false);
-  if (x1 == -1)
-    // EOF reached
-    return -1;
-  int x2 = get_one_v2(true);
+  // avoid xoring with 0
+  for (int i = 0x01; i <= 0xff; ++i) {
+    if (scores[i] == SCORE_INVALID)
+      // skip XORs the model rules out
+      continue;
 
-  int hi = char2int(x1);
-  int lo = char2int(x2);
+    printf("XOR with %d (0x%x) has score: %g\n", i, i, scores[i]);
+  }
 
-  return (((hi & 0x0f) << 4) | (lo & 0x0f));
-}
+  double highest_score;
+  int mask_for_highest_score = best_mask(scores, &highest_score);
+  if (mask_for_highest_score < 0)
+    mask_for_highest_score = 0;
 
-void read_buffer(std::string *buf) {
-  int c;
+  printf("Highest score was %g, obtained with mask %d (0x%x)\n",
+         highest_score, mask_for_highest_score, mask_for_highest_score);
 
-  while (true) {
-    c = get_one_hex_v2();
-    if (c == -1)
-      // EOF
-      break;
+  if (highest_score == SCORE_INVALID)
+    // print nothing if every mask was ruled out
+    return 1;
 
-    //printf("%d ", c);
+  {
+    std::string xord_buffer = xor_one(buf, mask_for_highest_score);
+    std::vector<int> frequencies(256, 0);
+    compute_frequencies(xord_buffer, &frequencies);
 
-    buf->append(1, c);
+    print_frequencies(stdout, frequencies);
+    printf("Result: %.*s\n", (int)xord_buffer.size(), xord_buffer.c_str());
   }
-}
 
-int compute_frequencies(const std::string &s, std::vector<int> *frequencies) {
-  bool has_nonprint = false;
+  return 0;
+}
 
-  for (const unsigned char c: s) {
-    ++(*frequencies)[c];
-    if (!is_valid(c))
-      has_nonprint = true;
+class XorResult {
+ public:
+  XorResult(size_t line, int mask, double score)
+      : line_(line), mask_(mask), score_(score) {}
+
+  size_t line_;
+  int mask_;
+  double score_;
+};
+class BetterResultComparator {
+ public:
+  bool operator() (const XorResult &lhs, const XorResult &rhs) const {
+    // Higher scores are better, ties go to the earlier line.
+    //
+    // Used as the 'less' of a priority_queue, this keeps the worst
+    // result at the top, which is the one to evict when a better one
+    // comes along.
+    if (lhs.score_ != rhs.score_)
+      return lhs.score_ > rhs.score_;
+    return lhs.line_ < rhs.line_;
   }
+};
+typedef std::priority_queue<XorResult, std::vector<XorResult>,
+                            BetterResultComparator> ResultHeap;
+
+// lines handed to a worker at a time
+static const size_t BATCH_LINES = 256;
+
+// Scores every mask against the lines the worker claims from 'next',
+// keeping the 'top_n' best results in 'heap'.
+void crack_lines(const std::vector<std::string_view> &lines, std::atomic<size_t> *next,
+                 const TextScorer *scorer, const size_t top_n, ResultHeap *heap) {
+  const BetterResultComparator better;
+  std::string buf;
 
-  if (has_nonprint)
-    // score is 0 if non-print chars are present
-    return 0;
-
-  // try and compute a reasonable score; give 1 base point to all
-  // chars, then 1 additional point for all letters or spaces, and 1
-  // other additional point for the 5 more common letters in english
-  // text (e, t, a, o, i)
-  int score = s.size(); // 1 base point
-  // ascii is 7 bits
-  for (unsigned char c = 0; c < 0x7f; ++c) {
-    if (!isalpha(c) && c != ' ')
-      continue;
-
-    switch (tolower(c)) {
-      case 'e':
-      case 't':
-      case 'a':
-      case 'o':
-      case 'i':
-        // 2 extra points
-        score += (*frequencies)[c] * 2;
-        break;
-
-      default:
-        // 1 extra point
-        score += (*frequencies)[c];
-        break;
+  while (true) {
+    const size_t first = next->fetch_add(BATCH_LINES);
+    if (first >= lines.size())
+      break;
+    const size_t last = std::min(first + BATCH_LINES, lines.size());
+
+    for (size_t line = first; line < last; ++line) {
+      buf.clear();
+      if (decodehex(&buf, lines[line]) < 0) {
+        fprintf(stderr, "Skipping line [%ld]: bad hex input\n", line + 1);
+        continue;
+      }
+
+      double scores[256];
+      scorer->score_masks(buf, scores);
+
+      // avoid xoring with 0
+      for (int i = 0x01; i <= 0xff; ++i) {
+        if (scores[i] == SCORE_INVALID)
+          // skip XORs the model rules out
+          continue;
+
+        XorResult result(line, i, scores[i]);
+        if (heap->size() < top_n) {
+          heap->push(result);
+        } else if (better(result, heap->top())) {
+          heap->pop();
+          heap->push(result);
+        }
+      }
     }
   }
-  return score;
 }
 
-void print_frequencies(const std::vector<int> &frequencies) {
-  for (unsigned int i = 0; i < frequencies.size(); ++i) {
-    if (!frequencies[i])
-      continue;
+// Cracks every line of the hex file at 'path' on all cores, and prints
+// the 'top_n' best (line, mask) pairs.
+int try_all_lines(const char *path, const size_t top_n) {
+  InputBuffer input;
+  if (input.load(path) < 0)
+    return 1;
 
-    printf("  %d (", i);
-    if (isprint(i))
-      printf("%c", i);
-    else
-      printf("nonprint");
-    printf("): %d times\n", frequencies[i]);
+  std::vector<std::string_view> lines;
+  std::string_view rest = input.view();
+  while (!rest.empty()) {
+    size_t end = rest.find('\n');
+    if (end == std::string_view::npos)
+      end = rest.size();
+    lines.push_back(rest.substr(0, end));
+    rest.remove_prefix(std::min(end + 1, rest.size()));
   }
-}
+  fprintf(stderr, "Got [%ld] lines\n", lines.size());
+
+  size_t threads_count = std::thread::hardware_concurrency();
+  if (!threads_count)
+    threads_count = 1;
+
+  const TextScorer &scorer = text_scorer(default_scoring_model());
+  std::atomic<size_t> next(0);
+  std::vector<ResultHeap> heaps(threads_count);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < threads_count; ++t)
+    threads.emplace_back(crack_lines, std::cref(lines), &next, &scorer, top_n, &heaps[t]);
+  for (std::thread &t : threads)
+    t.join();
+
+  // merge the per-thread results, best first
+  std::vector<XorResult> results;
+  for (ResultHeap &heap : heaps) {
+    for (; !heap.empty(); heap.pop())
+      results.push_back(heap.top());
+  }
+  std::sort(results.begin(), results.end(), BetterResultComparator());
+  if (results.size() > top_n)
+    results.erase(results.begin() + top_n, results.end());
 
-std::string xor_one(const std::string &buf, int int_mask) {
-  std::string result(buf);
+  if (results.empty())
+    // print nothing if every line was ruled out
+    return 1;
 
-  unsigned char mask = int_mask & 0x000000ff;
-  const size_t size = result.size();
-  for (size_t i = 0; i < size; ++i) {
-    result[i] = result[i] ^ mask;
+  std::string buf;
+  for (const XorResult &result : results) {
+    buf.clear();
+    decodehex(&buf, lines[result.line_]);
+    std::string xord_buffer = xor_one(buf, result.mask_);
+    printf("Line %ld, mask %d (0x%x), score %g: %.*s\n",
+           result.line_ + 1, result.mask_, result.mask_, result.score_,
+           (int)xord_buffer.size(), xord_buffer.c_str());
   }
 
-  return std::move(result);
+  return 0;
 }
 
-int try_all_xors(const std::string &buf) {
-  int highest_score = 0;
-  int mask_for_highest_score = 0;
-
-  // avoid xoring with 0
-  for (int i = 0x01; i <= 0xff; ++i) {
-    std::string xord_buffer = xor_one(buf, i);
-
-    std::vector<int> frequencies(256, 0);
-    int score = compute_frequencies(xord_buffer, &frequencies);
-
-    if (!score)
-      // skip XORs with score 0
-      continue;
-
-    printf("XOR with %d (0x%x) has score: %d\n", i, i, score);
-    //print_frequencies(frequencies);
-    //printf("Result: %.*s\n", (int)xord_buffer.size(), xord_buffer.c_str());
-
-    if (score > highest_score) {
-      highest_score = score;
-      mask_for_highest_score = i;
+int main (int argc, char *argv[]) {
+  if (argc > 1) {
+    // batch mode: xorcipher.bin --batch FILE [TOP_N]
+    if (strcmp(argv[1], "--batch") || argc < 3 || argc > 4) {
+      fprintf(stderr, "Usage: %s [--batch FILE [TOP_N]]\n", argv[0]);
+      return 1;
     }
-  }
 
-  printf("Highest score was %d, obtained with mask %d (0x%x)\n",
-         highest_score, mask_for_highest_score, mask_for_highest_score);
-
-  if (!highest_score)
-    // print nothing if highest score was 0
-    return 1;
-
-  {
-    std::string xord_buffer = xor_one(buf, mask_for_highest_score);
-    std::vector<int> frequencies(256, 0);
-    compute_frequencies(xord_buffer, &frequencies);
+    size_t top_n = 5;
+    if (argc == 4) {
+      top_n = strtoul(argv[3], NULL, 10);
+      if (!top_n) {
+        fprintf(stderr, "Bad TOP_N [%s]\n", argv[3]);
+        return 1;
+      }
+    }
 
-    print_frequencies(frequencies);
-    printf("Result: %.*s\n", (int)xord_buffer.size(), xord_buffer.c_str());
+    return try_all_lines(argv[2], top_n);
   }
 
-  return 0;
-}
+  InputBuffer input;
+  if (input.load("-") < 0)
+    return 1;
 
-int main (void) {
   std::string buf;
-
-  read_buffer(&buf);
+  if (decodehex(&buf, input.view()) < 0) {
+    fprintf(stderr, "Bad hex input\n");
+    return 1;
+  }
   //printf("\n%.*s\n", (int)buf.size(), buf.c_str());
 
   std::vector<int> frequencies(256, 0);
   /*int score =*/ compute_frequencies(buf, &frequencies);
 
   //printf("Original distribution (score %d):\n", score);
-  //print_frequencies(frequencies);
+  //print_frequencies(stdout, frequencies);
 
   return try_all_xors(buf);
 }
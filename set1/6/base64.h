@@ -1,5 +0,0 @@
-#pragma once
-
-#include <string>
-
-int decodebase64(std::string *result, const std::string &s);
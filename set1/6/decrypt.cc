@@ -1,207 +1,293 @@
-#include <queue>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
 #include <string>
 #include <vector>
-#include "base64.h"
-#include "repkey_xor.h"
-
-class KeysizeMetadata {
+#include "../../common/base64.h"
+#include "../../common/keysize.h"
+#include "../../common/repeating_key.h"
+#include "../../common/scoring.h"
+#include "../../common/strided_view.h"
+#include "../../common/thread_pool.h"
+#include "../../common/xor_search.h"
+
+// A key whose first bytes have been guessed, and how good the
+// cleartext they produce looks.
+class PartialKey {
  public:
-  KeysizeMetadata(int keysize, float distance)
-      : keysize_(keysize), distance_(distance) {}
-  KeysizeMetadata(const KeysizeMetadata &other)
-      : keysize_(other.keysize_), distance_(other.distance_) {}
+  PartialKey(const std::string &key, double score)
+      : key_(key), score_(score) {}
 
-  int keysize_;
-  float distance_;
+  std::string key_;
+  double score_;
 };
-class BetterKeysizeComparator {
+class BetterPartialKeyComparator {
  public:
-  bool operator() (const KeysizeMetadata &lhs, const KeysizeMetadata &rhs) const {
-    // We must determine if lhs is 'better' than rhs; comparison is
-    // done on the distance.
-    //
-    // Since the priority_queue calls this class with 'less'
-    // semantics, and places 'higher' elements at the beginning (i.e.,
-    // elements for which 'less' returns false when compared to
-    // everything else), we have to reverse the logic. Hence, return
-    // whether lhs is 'worse' than rhs.
-    return lhs.distance_ > rhs.distance_;
+  bool operator() (const PartialKey &lhs, const PartialKey &rhs) const {
+    return lhs.score_ > rhs.score_;
   }
 };
 
-int get_one_v2(const bool eof_is_error) {
-  int c = getchar();
-  if (c == EOF) {
-    if (eof_is_error) {
-      fprintf(stderr, "Unexpected EOF\n");
-      exit(1);
-    } else {
-      return -1;
-    }
-  }
-  return c;
-}
-
-void read_buffer(std::string *buf) {
-  int c;
-
-  while (true) {
-    c = get_one_v2(false);
-    if (c == -1)
-      // EOF
+// candidate bytes kept for each key byte, and partial keys kept
+// between key bytes
+static const int BEAM_CANDIDATES = 3;
+static const size_t BEAM_WIDTH = 4;
+// partial keys are rated on at most this many blocks of the input
+static const size_t BEAM_SAMPLE_BLOCKS = 256;
+// inputs at least this large are transposed into an arena once per
+// keysize rather than walked in place once per column
+static const size_t TRANSPOSE_MIN_SIZE = 1 << 20;
+
+// Rates a partial key by the cleartext it gives for the first
+// key.size() bytes of each block. Each block's prefix is scored on its
+// own, so that the bigram model never sees a pair made of the end of
+// one prefix and the start of the next; the result is their sum.
+double score_partial_key(const std::string &s, const int keysize, const std::string &key,
+                         const TextScorer &scorer) {
+  std::string prefix;
+  prefix.reserve(key.size());
+
+  double score = 0.0;
+  for (size_t block = 0; block < BEAM_SAMPLE_BLOCKS; ++block) {
+    const size_t start = block * keysize;
+    if (start >= s.size())
       break;
 
-    // printf("%d ", c);
-
-    buf->append(1, c);
+    prefix.clear();
+    for (size_t i = 0; i < key.size() && start + i < s.size(); ++i)
+      prefix.append(1, s[start + i] ^ key[i]);
+    score += scorer.score(prefix);
   }
-}
 
-int count_bits_set(const unsigned char &c) {
-  return __builtin_popcount(c);
+  return score;
 }
 
-int hamming_distance(const std::string &a, const std::string &b) {
-  if (a.size() != b.size())
-    // cannot compute distance
-    return -1;
-
-  int distance = 0;
-  size_t cursor = 0;
-  for (; cursor < a.size(); ++cursor) {
-    distance += count_bits_set(a[cursor] ^ b[cursor]);
-  }
-
-  return distance;
-}
+// State shared by the jobs working on one keysize: the candidate
+// bytes of each column, then the key they add up to.
+class KeysizeAttempt {
+ public:
+  explicit KeysizeAttempt(int keysize)
+      : keysize_(keysize), candidates_(keysize * BEAM_CANDIDATES),
+        found_(keysize, 0), columns_left_(keysize), done_(false),
+        score_(SCORE_INVALID) {}
+
+  const int keysize_;
+  std::vector<StridedView> columns_;
+  // backs 'columns_' when the input was transposed
+  std::string arena_;
+  // BEAM_CANDIDATES slots per column, 'found_' of them used
+  std::vector<MaskCandidate> candidates_;
+  std::vector<int> found_;
+  std::atomic<int> columns_left_;
+  // set once the key has been guessed and scored
+  bool done_;
+  std::string key_;
+  double score_;
+};
 
-std::vector<int> try_find_keysize(const std::string &s, const size_t keysizes_count) {
-  std::priority_queue<KeysizeMetadata, std::vector<KeysizeMetadata>,
-                      BetterKeysizeComparator> keysizes_data;
-
-  for (int keysize = 2; keysize < 40; ++keysize) {
-    std::string chunk1(s, 0, keysize);
-    std::string chunk2(s, keysize, keysize);
-    std::string chunk3(s, keysize * 2, keysize);
-    std::string chunk4(s, keysize * 3, keysize);
-
-    // use more than one sample
-    int distance = hamming_distance(chunk1, chunk2) +
-        hamming_distance(chunk2, chunk3) +
-        hamming_distance(chunk3, chunk4);
-    float normalized_distance = (float)distance / keysize;
-    fprintf(stderr, "Keysize [%d] generates distance [%d] (normalized %f)\n",
-            keysize, distance, normalized_distance);
-
-    keysizes_data.push(KeysizeMetadata(keysize, normalized_distance));
-  }
+// Guesses the key one byte at a time with a beam search over the
+// candidates each column proposed: the BEAM_WIDTH best partial keys
+// are carried over to the next column. Partial keys are ranked with
+// the bigram model, the only one that looks at neighbouring bytes
+// (and so across columns). Returns false if some column had no
+// plausible byte at all.
+bool beam_search_key(const std::string &s, const KeysizeAttempt &attempt, std::string *key) {
+  const TextScorer &beam_scorer = text_scorer(SCORING_BIGRAM);
+  std::vector<PartialKey> beam(1, PartialKey("", 0));
+
+  for (int column = 0; column < attempt.keysize_; ++column) {
+    const int found = attempt.found_[column];
+    if (!found) {
+      fprintf(stderr, "Keysize [%d]: failed to guess byte [%d] for the key\n", attempt.keysize_, column);
+      return false;
+    }
+    const MaskCandidate *candidates = &attempt.candidates_[column * BEAM_CANDIDATES];
+
+    std::vector<PartialKey> next_beam;
+    for (const PartialKey &partial : beam) {
+      for (int c = 0; c < found; ++c) {
+        std::string next_key = partial.key_;
+        next_key.append(1, candidates[c].mask_);
+        next_beam.push_back(PartialKey(
+            next_key, score_partial_key(s, attempt.keysize_, next_key, beam_scorer)));
+      }
+    }
 
-  // return the N best keysizes
-  std::vector<int> best_keysizes;
-  while (!keysizes_data.empty()) {
-    const KeysizeMetadata &top = keysizes_data.top();
-    best_keysizes.push_back(top.keysize_);
-    keysizes_data.pop();
-    if (best_keysizes.size() >= keysizes_count)
-      // we have collected enough keysizes
-      break;
+    std::stable_sort(next_beam.begin(), next_beam.end(), BetterPartialKeyComparator());
+    if (next_beam.size() > BEAM_WIDTH)
+      next_beam.erase(next_beam.begin() + BEAM_WIDTH, next_beam.end());
+    beam.swap(next_beam);
   }
 
-  return best_keysizes;
+  *key = beam.front().key_;
+  return true;
 }
 
-void break_blocks(const std::string &s, const int keysize, std::vector<std::string> *blocks) {
-  size_t cursor = 0;
-  const size_t size = s.size();
-
-  while (cursor < size) {
-    blocks->push_back(std::string(s, cursor, keysize));
-    cursor += keysize;
+// Breaks 's' on 'pool', trying all of 'keysizes' at once: each keysize
+// is cut into columns by one job, which spawns a job per column to collect
+// its candidate bytes (rated with 'column_scorer'), and the last of
+// those runs the beam search. Once a key yields a cleartext that
+// 'cleartext_scorer' deems to be text, the jobs still queued for the
+// other keysizes give up; keys are cut to their shortest period first,
+// so one found through a multiple of the key size is still the right
+// one. Stores the best key found in 'key'; returns
+// false if there was none.
+bool break_repkey_xor(const std::string &s, const std::vector<int> &keysizes,
+                      const TextScorer &column_scorer, const TextScorer &cleartext_scorer,
+                      ThreadPool *pool, std::string *key) {
+  std::vector<std::unique_ptr<KeysizeAttempt>> attempts;
+  for (int keysize: keysizes)
+    attempts.emplace_back(new KeysizeAttempt(keysize));
+  std::atomic<bool> solved(false);
+
+  for (std::unique_ptr<KeysizeAttempt> &attempt_ptr : attempts) {
+    KeysizeAttempt *attempt = attempt_ptr.get();
+
+    pool->submit([&s, &column_scorer, &cleartext_scorer, pool, &solved, attempt] {
+        if (solved.load())
+          return;
+
+        // the ciphertext cut in rows of keysize length, seen column
+        // by column
+        if (s.size() >= TRANSPOSE_MIN_SIZE) {
+          transpose_columns(s, attempt->keysize_, &attempt->arena_, &attempt->columns_);
+        } else {
+          for (int column = 0; column < attempt->keysize_; ++column)
+            attempt->columns_.push_back(column_view(s, attempt->keysize_, column));
+        }
+
+        for (int column = 0; column < attempt->keysize_; ++column) {
+          pool->submit([&s, &column_scorer, &cleartext_scorer, &solved, attempt, column] {
+              if (solved.load())
+                return;
+
+              attempt->found_[column] = top_xors(attempt->columns_[column], column_scorer, BEAM_CANDIDATES,
+                                                 &attempt->candidates_[column * BEAM_CANDIDATES]);
+              if (attempt->columns_left_.fetch_sub(1) != 1)
+                return;
+
+              // last column in: guess the whole key
+              std::string key;
+              if (!beam_search_key(s, *attempt, &key))
+                return;
+              // a multiple of the key size guesses the key repeated,
+              // and may get there before the key size itself: keep one
+              // period, so the key reported is the shortest
+              const size_t period = key_period(key);
+              if (period < key.size()) {
+                fprintf(stderr, "Keysize [%d]: key repeats every %ld bytes\n",
+                        attempt->keysize_, period);
+                key.resize(period);
+              }
+              attempt->score_ = cleartext_scorer.score(repkey_xor(key, s));
+              attempt->key_ = key;
+              attempt->done_ = true;
+              fprintf(stderr, "Keysize [%d]: cleartext scores %g\n", attempt->keysize_, attempt->score_);
+
+              if (attempt->score_ >= cleartext_scorer.text_threshold())
+                // found it!
+                solved.store(true);
+            });
+        }
+      });
   }
-}
-
-void transpose_blocks(const std::vector<std::string> &blocks, std::vector<std::string> *transposed_blocks) {
-  const size_t blocks_count = blocks.size();
-  const size_t max_block_length = blocks.front().size();
-
-  for (size_t index_in_block = 0; index_in_block < max_block_length; ++index_in_block) {
-    // take the char at index 'index_in_block' from each block and accumulate them
-    std::string result;
-
-    for (size_t block_idx = 0; block_idx < blocks_count; ++block_idx) {
-      const std::string &block = blocks[block_idx];
-      if (index_in_block >= block.size())
-        // trailing blocks might be shorter
-        break;
-      result.append(1, block[index_in_block]);
+  pool->wait();
+
+  // keysizes are in order of likelihood: on equal scores, keep the
+  // more likely one
+  double best_score = SCORE_INVALID;
+  for (const std::unique_ptr<KeysizeAttempt> &attempt : attempts) {
+    if (attempt->done_ && (key->empty() || attempt->score_ > best_score)) {
+      best_score = attempt->score_;
+      *key = attempt->key_;
     }
-
-    transposed_blocks->push_back(result);
   }
-}
 
-bool try_decrypt(const std::string &s, const int keysize) {
-  // break the ciphertext into blocks of keysize length
-  std::vector<std::string> blocks;
-  break_blocks(s, keysize, &blocks);
-  //fprintf(stderr, "[%ld] blocks created\n", blocks.size());
-
-  // transpose the blocks
-  std::vector<std::string> transposed_blocks;
-  transpose_blocks(blocks, &transposed_blocks);
-  //fprintf(stderr, "[%ld] transposed blocks created\n", transposed_blocks.size());
-
-  std::string key;
-  for (size_t transposed_block_idx = 0; transposed_block_idx < transposed_blocks.size(); ++transposed_block_idx) {
-    int one_byte_key;
-    if (!try_all_xors(transposed_blocks[transposed_block_idx], &one_byte_key)) {
-      fprintf(stderr, "Keysize [%d]: failed to guess byte [%ld] for the key\n", keysize, transposed_block_idx);
-      return false;
-    }
-    key.append(1, one_byte_key);
-  }
-
-  fprintf(stderr, "Key found of length [%d]:", keysize);
-  for (unsigned char b: key)
-    fprintf(stderr, " %d", b);
-  fprintf(stderr, "\n");
-
-  std::string cleartext = repkey_xor(key, s);
-  fprintf(stderr, "Cleartext: [%.*s]\n", (int)cleartext.size(), cleartext.c_str());
-
-  return true;
+  return !key->empty();
 }
 
 int main(int argc, char *argv[]) {
   // test basic preconditions
-  const int test_distance = hamming_distance("this is a test", "wokka wokka!!!");
+  const int64_t test_distance = hamming_distance("this is a test", "wokka wokka!!!");
   if (test_distance != 37) {
-    fprintf(stderr, "Validation failed: distance should be 37, but it is %d instead\n", test_distance);
+    fprintf(stderr, "Validation failed: distance should be 37, but it is %ld instead\n", test_distance);
     return 1;
   }
 
-  // read input
-  std::string buf;
-  read_buffer(&buf);
-  fprintf(stderr, "Got %ld bytes of input\n", buf.size());
+  // decrypt.bin [--keysizes MIN-MAX] [--estimator hamming|coincidence]
+  int min_keysize = 2;
+  int max_keysize = 40;
+  KeysizeEstimator estimator = KEYSIZE_HAMMING;
+  for (int i = 1; i < argc; i += 2) {
+    if (i + 1 >= argc) {
+      fprintf(stderr, "Usage: %s [--keysizes MIN-MAX] [--estimator hamming|coincidence]\n", argv[0]);
+      return 1;
+    }
 
-  // decode base64
+    if (!strcmp(argv[i], "--keysizes")) {
+      if (sscanf(argv[i + 1], "%d-%d", &min_keysize, &max_keysize) != 2 ||
+          min_keysize < 1 || max_keysize < min_keysize) {
+        fprintf(stderr, "Bad keysize range [%s]\n", argv[i + 1]);
+        return 1;
+      }
+    } else if (!strcmp(argv[i], "--estimator")) {
+      if (parse_keysize_estimator(argv[i + 1], &estimator) < 0) {
+        fprintf(stderr, "Unknown estimator [%s]\n", argv[i + 1]);
+        return 1;
+      }
+    } else {
+      fprintf(stderr, "Usage: %s [--keysizes MIN-MAX] [--estimator hamming|coincidence]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  // read and decode the base64 input as it comes
   std::string decoded_input;
-  int result = decodebase64(&decoded_input, buf);
+  int result = decodebase64_fd(STDIN_FILENO, [&decoded_input](const unsigned char *data, size_t size) {
+      decoded_input.append((const char *)data, size);
+    });
   if (result < 0) {
     fprintf(stderr, "Bad base64 input\n");
     return 1;
   }
   fprintf(stderr, "Decoded %ld bytes of input\n", decoded_input.size());
 
-  std::vector<int> keysizes = try_find_keysize(decoded_input, 5);
-  fprintf(stderr, "Guessed [%ld] keysizes:\n", keysizes.size());
-  for (int keysize: keysizes) {
-    fprintf(stderr, "Trying keysize [%d]\n", keysize);
-    if (try_decrypt(decoded_input, keysize))
-      // found it!
-      break;
+  // bigrams make no sense on the transposed columns, whose bytes are
+  // keysize apart in the cleartext: those get the unigram model
+  const ScoringModel model = default_scoring_model();
+  const TextScorer &cleartext_scorer = text_scorer(model);
+  const TextScorer &column_scorer =
+      text_scorer(model == SCORING_BIGRAM ? SCORING_LOG_LIKELIHOOD : model);
+
+  std::vector<int> keysizes = likely_keysizes(decoded_input, min_keysize, max_keysize, estimator, 5);
+  if (keysizes.empty()) {
+    fprintf(stderr, "Keysizes from [%d] are too long for the input\n", min_keysize);
+    return 1;
   }
+  fprintf(stderr, "Guessed [%ld] keysizes:", keysizes.size());
+  for (int keysize: keysizes)
+    fprintf(stderr, " %d (%f)", keysize, rate_keysize(decoded_input, keysize, estimator));
+  fprintf(stderr, "\n");
+
+  ThreadPool pool;
+  std::string best_key;
+  if (!break_repkey_xor(decoded_input, keysizes, column_scorer, cleartext_scorer,
+                        &pool, &best_key)) {
+    fprintf(stderr, "No key found\n");
+    return 1;
+  }
+
+  fprintf(stderr, "Key found of length [%ld]:", best_key.size());
+  for (unsigned char b: best_key)
+    fprintf(stderr, " %d", b);
+  fprintf(stderr, "\n");
+
+  std::string cleartext = repkey_xor(best_key, decoded_input);
+  fprintf(stderr, "Cleartext: [%.*s]\n", (int)cleartext.size(), cleartext.c_str());
 
   return 0;
 }
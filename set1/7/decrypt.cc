@@ -1,77 +1,171 @@
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <string>
-#include <openssl/err.h>
-#include <openssl/evp.h>
-#include "base64.h"
-
-typedef std::basic_string<unsigned char> u_string;
-
-int get_one_v2(const bool eof_is_error) {
-  int c = getchar();
-  if (c == EOF) {
-    if (eof_is_error) {
-      fprintf(stderr, "Unexpected EOF\n");
-      exit(1);
+#include "../../common/aes_ecb.h"
+#include "../../common/base64.h"
+#include "../../common/pkcs7.h"
+#include "../../common/thread_pool.h"
+
+static const unsigned char *KEY = (const unsigned char *)"YELLOW SUBMARINE";
+// inputs at least this large are decrypted on all cores
+static const size_t PARALLEL_MIN_SIZE = 8 << 20;
+
+// Decrypts 'ciphertext' again with every AES implementation, serially
+// and in parallel, and compares the results to 'cleartext'. Returns 0
+// if they all match.
+int cross_check(const std::string &ciphertext, const std::string &cleartext) {
+  static const AesBackend backends[] = {AES_BACKEND_TABLE, AES_BACKEND_AESNI, AES_BACKEND_OPENSSL};
+  static const char *names[] = {"table", "aesni", "openssl"};
+
+  int result = 0;
+  for (size_t i = 0; i < sizeof(backends) / sizeof(backends[0]); ++i) {
+    AesEcb *aes = new AesEcb(backends[i]);
+    std::string decrypted(ciphertext.size(), '\0');
+    if (aes->init(KEY, false) < 0 ||
+        aes->process((unsigned char *)&decrypted[0], (const unsigned char *)ciphertext.data(),
+                     ciphertext.size()) < 0 ||
+        decrypted != cleartext) {
+      fprintf(stderr, "Backend [%s]: MISMATCH\n", names[i]);
+      result = -1;
     } else {
-      return -1;
+      fprintf(stderr, "Backend [%s]: same cleartext\n", names[i]);
     }
+    delete aes;
   }
-  return c;
-}
-
-void read_buffer(std::string *buf) {
-  int c;
 
-  while (true) {
-    c = get_one_v2(false);
-    if (c == -1)
-      // EOF
-      break;
+  ThreadPool pool;
+  std::string decrypted(ciphertext.size(), '\0');
+  if (aes_ecb_parallel(KEY, false, (unsigned char *)&decrypted[0],
+                       (const unsigned char *)ciphertext.data(), ciphertext.size(), &pool) < 0 ||
+      decrypted != cleartext) {
+    fprintf(stderr, "Parallel: MISMATCH\n");
+    result = -1;
+  } else {
+    fprintf(stderr, "Parallel: same cleartext\n");
+  }
 
-    // printf("%d ", c);
+  return result;
+}
 
-    buf->append(1, c);
+// Writes the 'size' bytes at 'data' to stdout. Returns 0 on success,
+// or -1 after reporting the error.
+int write_cleartext(const unsigned char *data, size_t size) {
+  if (fwrite(data, 1, size, stdout) != size) {
+    fprintf(stderr, "%s: write error\n", __FUNCTION__);
+    return -1;
   }
+  return 0;
 }
 
-// http://stackoverflow.com/q/16560720/1451820
-u_string decrypt(const u_string &ciphertext, const u_string &key) {
-  EVP_CIPHER_CTX ctx;
-  EVP_CIPHER_CTX_init(&ctx);
-  EVP_CIPHER_CTX_set_padding(&ctx, false);
-  EVP_DecryptInit_ex(&ctx, EVP_aes_128_ecb(), NULL, key.c_str(), NULL);
+// Takes the padding off the last block of the cleartext, whose
+// 'size' bytes (a non-zero multiple of the block size) end at 'end',
+// and stores the unpadded size in 'unpadded'. Returns 0 on success, or
+// -1 after reporting the error.
+int unpad_cleartext(const unsigned char *end, size_t size, size_t *unpadded) {
+  size_t last;
+  if (!size || pkcs7_unpad(end - AES_BLOCK_SIZE, AES_BLOCK_SIZE, AES_BLOCK_SIZE, &last) < 0) {
+    fprintf(stderr, "Bad padding\n");
+    return -1;
+  }
+  *unpadded = size - AES_BLOCK_SIZE + last;
+  return 0;
+}
 
-  unsigned char buffer[10240], *pointer = buffer;
-  int outlen;
-  EVP_DecryptUpdate(&ctx, pointer, &outlen, ciphertext.c_str(), ciphertext.length());
-  pointer += outlen;
-  EVP_DecryptFinal_ex(&ctx, pointer, &outlen);
-  pointer += outlen;
+// Decodes the base64 input and decrypts it as it comes, writing the
+// cleartext to stdout; only the last block is held back, to take its
+// padding off at the end. Stores the size written in 'written'.
+// Returns 0 on success, or -1 after reporting the error.
+int decrypt_stream(size_t *written) {
+  AesEcb &aes = thread_aes_ecb();
+  if (aes.init(KEY, false) < 0)
+    return -1;
 
-  EVP_CIPHER_CTX_cleanup(&ctx);
+  // the last block decrypted so far
+  unsigned char last[AES_BLOCK_SIZE];
+  size_t decrypted = 0;
+  bool failed = false;
+  const AesEcb::Sink write = [&](const unsigned char *data, size_t size) {
+    // the sink gets whole blocks: the held one goes out, and the last
+    // of these stays
+    if (decrypted && write_cleartext(last, AES_BLOCK_SIZE) < 0)
+      failed = true;
+    if (write_cleartext(data, size - AES_BLOCK_SIZE) < 0)
+      failed = true;
+    memcpy(last, data + size - AES_BLOCK_SIZE, AES_BLOCK_SIZE);
+    decrypted += size;
+  };
+  size_t decoded = 0;
+  int result = decodebase64_fd(STDIN_FILENO, [&](const unsigned char *data, size_t size) {
+      decoded += size;
+      if (!failed && aes.update(data, size, write) < 0)
+        failed = true;
+    });
+  if (result < 0) {
+    fprintf(stderr, "Bad base64 input\n");
+    return -1;
+  }
+  fprintf(stderr, "Decoded %ld bytes of input\n", decoded);
+  if (failed || aes.finish() < 0 || unpad_cleartext(last + AES_BLOCK_SIZE, decrypted, written) < 0)
+    return -1;
 
-  return u_string(buffer, pointer-buffer);
+  return write_cleartext(last, AES_BLOCK_SIZE - (decrypted - *written));
 }
 
 int main(int argc, char *argv[]) {
-  // read input
-  std::string buf;
-  read_buffer(&buf);
-  fprintf(stderr, "Got %ld bytes of input\n", buf.size());
-
-  // decode base64
-  std::string decoded_input;
-  int result = decodebase64(&decoded_input, buf);
+  // decrypt.bin [--check]: with --check, compare all AES
+  // implementations on the input
+  const bool check = argc == 2 && !strcmp(argv[1], "--check");
+  if (argc > 1 && !check) {
+    fprintf(stderr, "Usage: %s [--check]\n", argv[0]);
+    return 1;
+  }
+
+  // a large regular file is decoded whole and decrypted on all cores,
+  // as is the input to check; anything else is decrypted as it comes,
+  // straight to stdout
+  struct stat st;
+  const bool large = !fstat(STDIN_FILENO, &st) && S_ISREG(st.st_mode) &&
+      (size_t)st.st_size / 4 * 3 >= PARALLEL_MIN_SIZE;
+  size_t written = 0;
+  if (!large && !check) {
+    if (decrypt_stream(&written) < 0)
+      return 1;
+    fprintf(stderr, "Decrypted %ld bytes of cleartext\n", written);
+    return 0;
+  }
+
+  std::string ciphertext, cleartext;
+  int result = decodebase64_fd(STDIN_FILENO, [&ciphertext](const unsigned char *data, size_t size) {
+      ciphertext.append((const char *)data, size);
+    });
   if (result < 0) {
     fprintf(stderr, "Bad base64 input\n");
     return 1;
   }
-  fprintf(stderr, "Decoded %ld bytes of input\n", decoded_input.size());
+  fprintf(stderr, "Decoded %ld bytes of input\n", ciphertext.size());
 
-  ERR_load_crypto_strings();
-  u_string ciphertext((unsigned char *) decoded_input.c_str(), decoded_input.size());
-  u_string cleartext = decrypt(ciphertext, (unsigned char *) "YELLOW SUBMARINE");
-  fprintf(stderr, "Decrypted %ld bytes of input\n", cleartext.size());
-  fprintf(stderr, "Cleartext: [%.*s]\n", (int)cleartext.size(), cleartext.c_str());
+  // ECB blocks are independent: large inputs are split across cores,
+  // each decrypting its own range of the output
+  cleartext.resize(ciphertext.size());
+  unsigned char *out = (unsigned char *)&cleartext[0];
+  const unsigned char *in = (const unsigned char *)ciphertext.data();
+  if (ciphertext.size() >= PARALLEL_MIN_SIZE) {
+    ThreadPool pool;
+    result = aes_ecb_parallel(KEY, false, out, in, ciphertext.size(), &pool);
+  } else {
+    AesEcb &aes = thread_aes_ecb();
+    result = aes.init(KEY, false);
+    if (!result)
+      result = aes.process(out, in, ciphertext.size());
+  }
+  if (result < 0 || unpad_cleartext(out + cleartext.size(), cleartext.size(), &written) < 0 ||
+      write_cleartext(out, written) < 0)
+    return 1;
+  fprintf(stderr, "Decrypted %ld bytes of cleartext\n", written);
+
+  if (check && cross_check(ciphertext, cleartext) < 0)
+    return 1;
 
   return 0;
 }
@@ -1,94 +1,171 @@
 #include <stdio.h>
 #include <stdlib.h>
-#include <map>
+#include <string.h>
+#include <algorithm>
 #include <string>
+#include <string_view>
 #include <vector>
-#include "repkey_xor.h"
+#include "../../common/ecb_detect.h"
+#include "../../common/hex.h"
+#include "../../common/input.h"
+#include "../../common/thread_pool.h"
+
+// Returns the next line of 'input', decoded from hex; an empty string
+// means EOF.
+std::string read_one_line(std::string_view input, size_t *cursor) {
+  if (*cursor >= input.size())
+    // EOF
+    return "";
+
+  size_t end = input.find('\n', *cursor);
+  if (end == std::string_view::npos)
+    end = input.size();
+  std::string_view line = input.substr(*cursor, end - *cursor);
+  *cursor = end + 1;
 
-int char2int(int c) {
-  if (c >= '0' && c <= '9')
-    return c - '0';
-  if (c >= 'a' && c <= 'f')
-    return c - 'a' + 10;
+  // hex 2 binary
+  std::string s(line.size() / 2, '\0');
+  if (hex_decode((unsigned char *)&s[0], line.data(), line.size()) < 0) {
+    fprintf(stderr, "%s: bad hex line\n", __FUNCTION__);
+    exit(1);
+  }
 
-  fprintf(stderr, "%s: unexpected char %d\n", __FUNCTION__, c);
-  exit(1);
+  return s;
 }
 
-int hex2bin(unsigned char x1, unsigned char x2) {
-  int hi = char2int(x1);
-  int lo = char2int(x2);
+bool try_detect(const std::string &s) {
+  std::vector<RepeatedBlock> repeats;
+  if (!detect_ecb(s, false, &repeats))
+    return false;
 
-  return (((hi & 0x0f) << 4) | (lo & 0x0f));
-}
+  // print the repeated blocks
+  for (const RepeatedBlock &r : repeats)
+    fprintf(stderr, "  block at offset %ld is repeated %d times\n", r.offset_, r.count_);
 
-std::string read_one_line() {
-  char *line = NULL;
-  size_t length = 0;
+  return true;
+}
 
-  ssize_t retval = getline(&line, &length, stdin);
-  if (retval == -1) {
-    // EOF
-    return "";
+class EcbResult {
+ public:
+  EcbResult(size_t line, int repeated) : line_(line), repeated_(repeated) {}
+
+  size_t line_;
+  int repeated_;
+};
+class BetterEcbResultComparator {
+ public:
+  bool operator() (const EcbResult &lhs, const EcbResult &rhs) const {
+    // more repeated blocks first, earlier lines first on ties
+    if (lhs.repeated_ != rhs.repeated_)
+      return lhs.repeated_ > rhs.repeated_;
+    return lhs.line_ < rhs.line_;
   }
+};
+
+// What a worker found in one shard of the corpus; lines are numbered
+// from the start of the shard until all shards are counted.
+class EcbShard {
+ public:
+  EcbShard(std::string_view text) : text_(text), lines_(0) {}
+
+  std::string_view text_;
+  size_t lines_;
+  std::vector<EcbResult> results_;
+};
+
+// shards handed to the workers: a few per thread, so that a slow one
+// does not hold up the others
+static const size_t SHARDS_PER_THREAD = 4;
+static const size_t MIN_SHARD_SIZE = 1 << 20;
+
+// Decodes every line of the shard and tests it for repeated blocks.
+void scan_shard(EcbShard *shard) {
+  std::string buf;
+  std::string_view rest = shard->text_;
+  while (!rest.empty()) {
+    size_t end = rest.find('\n');
+    if (end == std::string_view::npos)
+      end = rest.size();
+    std::string_view line = rest.substr(0, end);
+    rest.remove_prefix(std::min(end + 1, rest.size()));
+    const size_t line_number = shard->lines_++;
+
+    buf.resize(line.size() / 2);
+    if (hex_decode((unsigned char *)&buf[0], line.data(), line.size()) < 0) {
+      fprintf(stderr, "Skipping a line: bad hex input\n");
+      continue;
+    }
 
-  // remove newline
-  if (line[retval-1] == '\n') {
-    line[retval-1] = '\0';
-    --retval;
+    const int repeated = detect_ecb(buf, false, NULL);
+    if (repeated)
+      shard->results_.push_back(EcbResult(line_number, repeated));
   }
+}
 
-  // hex 2 binary
-  std::string s;
-  s.reserve(length / 2);
-  for (ssize_t i = 0; i < retval; i += 2) {
-    if ((i + 1) == retval) {
-      fprintf(stderr, "%s: buffer with odd number of chars\n", __FUNCTION__);
-      exit(1);
+// Scans the hex file at 'path' line by line on all cores, and prints
+// the lines with repeated blocks, most repeated first.
+int scan_lines(const char *path) {
+  InputBuffer input;
+  if (input.load(path) < 0)
+    return 1;
+
+  ThreadPool pool;
+  size_t shard_size = input.view().size() / (pool.threads_count() * SHARDS_PER_THREAD);
+  if (shard_size < MIN_SHARD_SIZE)
+    shard_size = MIN_SHARD_SIZE;
+
+  // cut the corpus in shards ending on newlines
+  std::vector<EcbShard> shards;
+  std::string_view rest = input.view();
+  while (!rest.empty()) {
+    size_t end = rest.size();
+    if (end > shard_size) {
+      end = rest.find('\n', shard_size);
+      end = end == std::string_view::npos ? rest.size() : end + 1;
     }
-
-    s.append(1, hex2bin(line[i], line[i+1]));
+    shards.push_back(EcbShard(rest.substr(0, end)));
+    rest.remove_prefix(end);
   }
 
-  free(line);
-
-  return s;
-}
-
-std::vector<std::string> chunk_it(const std::string &s, const size_t chunk_size) {
-  std::vector<std::string> chunks;
+  for (EcbShard &shard : shards)
+    pool.submit([&shard] { scan_shard(&shard); });
+  pool.wait();
+
+  // number the lines across shards and merge the results
+  std::vector<EcbResult> results;
+  size_t first_line = 0;
+  for (const EcbShard &shard : shards) {
+    for (const EcbResult &result : shard.results_)
+      results.push_back(EcbResult(first_line + result.line_, result.repeated_));
+    first_line += shard.lines_;
+  }
+  std::stable_sort(results.begin(), results.end(), BetterEcbResultComparator());
+  fprintf(stderr, "Scanned [%ld] lines, [%ld] with repeated blocks\n", first_line, results.size());
 
-  for (size_t cursor = 0; cursor < s.size(); cursor += chunk_size)
-    chunks.push_back(s.substr(cursor, chunk_size));
+  for (const EcbResult &result : results)
+    printf("Line %ld: %d repeated blocks\n", result.line_ + 1, result.repeated_);
 
-  return chunks;
+  return 0;
 }
 
-bool try_detect(const std::string &s) {
-  std::vector<std::string> chunks = chunk_it(s, 16);
-
-  // find frequencies of chunks
-  std::map<std::string, int> chunk_frequencies;
-  for (const std::string &c : chunks)
-    ++chunk_frequencies[c];
-
-  // print frequencies of chunks
-  int i = 0;
-  bool retval = false;
-  for (auto &f : chunk_frequencies) {
-    if (f.second != 1) {
-      fprintf(stderr, "  chunk idx %d has frequency %d\n", i, f.second);
-      retval = true;
+int main (int argc, char *argv[]) {
+  if (argc > 1) {
+    // scanner mode: detect_ecb.bin --scan FILE
+    if (strcmp(argv[1], "--scan") || argc != 3) {
+      fprintf(stderr, "Usage: %s [--scan FILE]\n", argv[0]);
+      return 1;
     }
-    ++i;
+
+    return scan_lines(argv[2]);
   }
 
-  return retval;
-}
+  InputBuffer input;
+  if (input.load("-") < 0)
+    return 1;
 
-int main (void) {
+  size_t cursor = 0;
   while (true) {
-    std::string buf = read_one_line();
+    std::string buf = read_one_line(input.view(), &cursor);
     if (buf.empty())
       // EOF
       break;
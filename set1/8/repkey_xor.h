@@ -1,4 +0,0 @@
-#pragma once
-
-bool try_all_xors(const std::string &buf, int *best_mask);
-std::string repkey_xor(const std::string &key, const std::string &s);
@@ -0,0 +1,98 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <memory>
+#include <string>
+#include <openssl/evp.h>
+#include "../../common/aes_cbc.h"
+#include "../../common/base64.h"
+#include "../../common/thread_pool.h"
+
+static const unsigned char *KEY = (const unsigned char *)"YELLOW SUBMARINE";
+static const unsigned char IV[AES_BLOCK_SIZE] = {0};
+
+// Decrypts 'ciphertext' with OpenSSL, checks that encrypting
+// 'cleartext' again gives 'ciphertext' back, and decrypts a large
+// message both serially and in parallel. Returns 0 if they all agree.
+int cross_check(const std::string &ciphertext, const std::string &cleartext) {
+  int result = 0;
+
+  EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+  std::string decrypted(ciphertext.size(), '\0');
+  int size = 0, last = 0;
+  if (!ctx || !EVP_DecryptInit_ex(ctx, EVP_aes_128_cbc(), NULL, KEY, IV) ||
+      !EVP_DecryptUpdate(ctx, (unsigned char *)&decrypted[0], &size,
+                         (const unsigned char *)ciphertext.data(), ciphertext.size()) ||
+      !EVP_DecryptFinal_ex(ctx, (unsigned char *)&decrypted[size], &last) ||
+      decrypted.substr(0, size + last) != cleartext) {
+    fprintf(stderr, "OpenSSL: MISMATCH\n");
+    result = -1;
+  } else {
+    fprintf(stderr, "OpenSSL: same cleartext\n");
+  }
+  EVP_CIPHER_CTX_free(ctx);
+
+  std::string encrypted;
+  if (aes_cbc_encrypt(KEY, IV, cleartext, &encrypted) < 0 || encrypted != ciphertext) {
+    fprintf(stderr, "Encryption: MISMATCH\n");
+    result = -1;
+  } else {
+    fprintf(stderr, "Encryption: same ciphertext\n");
+  }
+
+  // large enough to be split across threads
+  std::string large;
+  while (large.size() < (16 << 20))
+    large.append(cleartext);
+  std::string serial, parallel;
+  ThreadPool pool;
+  if (aes_cbc_encrypt(KEY, IV, large, &encrypted) < 0 ||
+      aes_cbc_decrypt(KEY, IV, encrypted, &serial) < 0 ||
+      aes_cbc_decrypt(KEY, IV, encrypted, &parallel, &pool) < 0 ||
+      serial != large || parallel != large) {
+    fprintf(stderr, "Parallel: MISMATCH\n");
+    result = -1;
+  } else {
+    fprintf(stderr, "Parallel: same cleartext\n");
+  }
+
+  return result;
+}
+
+int main(int argc, char *argv[]) {
+  // decrypt.bin [--check]: with --check, compare with OpenSSL and the
+  // other paths
+  const bool check = argc == 2 && !strcmp(argv[1], "--check");
+  if (argc > 1 && !check) {
+    fprintf(stderr, "Usage: %s [--check]\n", argv[0]);
+    return 1;
+  }
+
+  // read and decode the base64 input as it comes
+  std::string ciphertext;
+  int result = decodebase64_fd(STDIN_FILENO, [&ciphertext](const unsigned char *data, size_t size) {
+      ciphertext.append((const char *)data, size);
+    });
+  if (result < 0) {
+    fprintf(stderr, "Bad base64 input\n");
+    return 1;
+  }
+  fprintf(stderr, "Decoded %ld bytes of input\n", ciphertext.size());
+
+  // every plaintext block only needs two ciphertext blocks: large
+  // inputs are split across cores, no pool is started for the others
+  std::string cleartext;
+  std::unique_ptr<ThreadPool> pool;
+  if (ciphertext.size() >= AES_CBC_PARALLEL_MIN_SIZE)
+    pool.reset(new ThreadPool());
+  if (aes_cbc_decrypt(KEY, IV, ciphertext, &cleartext, pool.get()) < 0)
+    return 1;
+
+  fprintf(stderr, "Decrypted %ld bytes of input\n", cleartext.size());
+  fprintf(stderr, "Cleartext: [%.*s]\n", (int)cleartext.size(), cleartext.c_str());
+
+  if (check && cross_check(ciphertext, cleartext) < 0)
+    return 1;
+
+  return 0;
+}
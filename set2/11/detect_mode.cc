@@ -0,0 +1,74 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <openssl/rand.h>
+#include "../../common/aes_oracle.h"
+#include "../../common/oracle_detect.h"
+
+// Profiles 'trials' oracles, each picking ECB or CBC at random and
+// padding its messages randomly, and checks what was found. Returns
+// the number of wrong guesses.
+int run_trials(const size_t trials, const size_t batch) {
+  size_t wrong = 0, ecb = 0, calls = 0, plaintexts = 0;
+  const auto start = std::chrono::steady_clock::now();
+
+  for (size_t trial = 0; trial < trials; ++trial) {
+    unsigned char coin;
+    if (RAND_bytes(&coin, 1) != 1) {
+      fprintf(stderr, "Cannot flip a coin\n");
+      return -1;
+    }
+    const CipherMode mode = coin & 1 ? CIPHER_MODE_ECB : CIPHER_MODE_CBC;
+    AesOracle oracle(mode, "", true, batch);
+
+    OracleProfile profile;
+    if (profile_oracle(&oracle, &profile) < 0)
+      return -1;
+
+    if (profile.ecb_ != (mode == CIPHER_MODE_ECB) || profile.block_size_ != AES_BLOCK_SIZE) {
+      fprintf(stderr, "Trial %ld: guessed %s with %ld-byte blocks, oracle used %s\n", trial,
+              profile.ecb_ ? "ECB" : "CBC", profile.block_size_,
+              mode == CIPHER_MODE_ECB ? "ECB" : "CBC");
+      ++wrong;
+    }
+    ecb += mode == CIPHER_MODE_ECB;
+    calls += oracle.calls();
+    plaintexts += oracle.plaintexts();
+  }
+
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  printf("%ld trials (%ld ECB), %ld wrong\n", trials, ecb, wrong);
+  printf("%.2f calls and %.2f plaintexts per trial, %.0f trials/s\n",
+         (double)calls / trials, (double)plaintexts / trials, trials / elapsed.count());
+
+  return wrong;
+}
+
+int main(int argc, char *argv[]) {
+  // detect_mode.bin [--trials N] [--batch N]
+  size_t trials = 1000, batch = 1;
+  for (int i = 1; i < argc; i += 2) {
+    if (i + 1 >= argc) {
+      fprintf(stderr, "Usage: %s [--trials N] [--batch N]\n", argv[0]);
+      return 1;
+    }
+
+    char *end;
+    const size_t value = strtoul(argv[i + 1], &end, 10);
+    if (*end || !value) {
+      fprintf(stderr, "Bad number [%s]\n", argv[i + 1]);
+      return 1;
+    }
+    if (!strcmp(argv[i], "--trials")) {
+      trials = value;
+    } else if (!strcmp(argv[i], "--batch")) {
+      batch = value;
+    } else {
+      fprintf(stderr, "Usage: %s [--trials N] [--batch N]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  return run_trials(trials, batch) ? 1 : 0;
+}
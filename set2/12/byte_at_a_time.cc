@@ -0,0 +1,52 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <chrono>
+#include <string>
+#include "../../common/aes_oracle.h"
+#include "../../common/base64.h"
+#include "../../common/byte_at_a_time.h"
+
+int main(int argc, char *argv[]) {
+  // byte_at_a_time.bin [--batch N]: with N > 1, the oracle takes N
+  // plaintexts per call
+  size_t batch = 1;
+  if (argc > 1) {
+    char *end = NULL;
+    if (argc == 3 && !strcmp(argv[1], "--batch"))
+      batch = strtoul(argv[2], &end, 10);
+    if (!end || *end || !batch) {
+      fprintf(stderr, "Usage: %s [--batch N]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  // the secret the oracle appends, in base64
+  std::string secret;
+  if (decodebase64_fd(STDIN_FILENO, [&secret](const unsigned char *data, size_t size) {
+        secret.append((const char *)data, size);
+      }) < 0) {
+    fprintf(stderr, "Bad base64 input\n");
+    return 1;
+  }
+
+  AesOracle oracle(CIPHER_MODE_ECB, secret, false, batch);
+  std::string recovered;
+  const auto start = std::chrono::steady_clock::now();
+  if (recover_ecb_suffix(&oracle, &recovered) < 0)
+    return 1;
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  fprintf(stderr, "Recovered %ld bytes in %ld calls: %.2f calls/byte, %.2f plaintexts/byte, "
+          "%.0f bytes/s\n", recovered.size(), oracle.calls(),
+          (double)oracle.calls() / recovered.size(),
+          (double)oracle.plaintexts() / recovered.size(), recovered.size() / elapsed.count());
+  if (recovered != secret) {
+    fprintf(stderr, "MISMATCH with the secret\n");
+    return 1;
+  }
+
+  fwrite(recovered.data(), 1, recovered.size(), stdout);
+  return 0;
+}
@@ -0,0 +1,155 @@
+#include <string.h>
+#include <string>
+#include <openssl/evp.h>
+#include "aes.h"
+#include "aes_cbc.h"
+#include "test_util.h"
+#include "thread_pool.h"
+
+static const AesBackend BACKENDS[] = {AES_BACKEND_TABLE, AES_BACKEND_AESNI};
+static const char *BACKEND_NAMES[] = {"table", "aesni"};
+
+// AES-128-CBC of 's' straight from EVP, with PKCS#7 padding or without
+// (then on a whole number of blocks). Decryption returns "" on error.
+static std::string reference_cbc(const std::string &key, const std::string &iv,
+                                 const bool encrypt, const bool padding, const std::string &s) {
+  EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+  std::string out(s.size() + AES_BLOCK_SIZE, '\0');
+  int size = 0, final_size = 0;
+  EVP_CipherInit_ex(ctx, EVP_aes_128_cbc(), NULL, (const unsigned char *)key.data(),
+                    (const unsigned char *)iv.data(), encrypt);
+  EVP_CIPHER_CTX_set_padding(ctx, padding);
+  const bool ok = EVP_CipherUpdate(ctx, (unsigned char *)&out[0], &size,
+                                   (const unsigned char *)s.data(), s.size()) &&
+      EVP_CipherFinal_ex(ctx, (unsigned char *)&out[size], &final_size);
+  EVP_CIPHER_CTX_free(ctx);
+  out.resize(ok ? size + final_size : 0);
+  return out;
+}
+
+// Runs the unpadded cores and Aes128's chained calls of each backend
+// over 'blocks' random blocks, in place or not.
+static void check_blocks(size_t blocks, ThreadPool *pool) {
+  const std::string key = random_bytes(AES_KEY_SIZE);
+  const std::string iv = random_bytes(AES_BLOCK_SIZE);
+  const std::string cleartext = random_bytes(blocks * AES_BLOCK_SIZE);
+  const std::string ciphertext = reference_cbc(key, iv, true, false, cleartext);
+  const size_t size = cleartext.size();
+
+  for (int b = 0; b < 2; ++b) {
+    Aes128 aes(BACKENDS[b]);
+    aes.set_key((const unsigned char *)key.data());
+
+    std::string out(size, '\0');
+    aes_cbc_encrypt_blocks(aes, (const unsigned char *)iv.data(), (unsigned char *)&out[0],
+                           (const unsigned char *)cleartext.data(), size);
+    EXPECT(out == ciphertext, "[%s] aes_cbc_encrypt_blocks differs on %ld blocks",
+           BACKEND_NAMES[b], blocks);
+    aes_cbc_decrypt_blocks(aes, (const unsigned char *)iv.data(), (unsigned char *)&out[0],
+                           (const unsigned char *)out.data(), size, pool);
+    EXPECT(out == cleartext, "[%s] in-place aes_cbc_decrypt_blocks differs on %ld blocks%s",
+           BACKEND_NAMES[b], blocks, pool ? " in parallel" : "");
+
+    // the chain carries over from one call to the next through 'iv'
+    for (const bool encrypt : {true, false}) {
+      const std::string &in = encrypt ? cleartext : ciphertext;
+      unsigned char chain[AES_BLOCK_SIZE];
+      memcpy(chain, iv.data(), AES_BLOCK_SIZE);
+      for (size_t i = 0; i < blocks;) {
+        size_t count = 1 + random_length(20);
+        if (count > blocks - i)
+          count = blocks - i;
+        unsigned char *o = (unsigned char *)&out[i * AES_BLOCK_SIZE];
+        const unsigned char *n = (const unsigned char *)&in[i * AES_BLOCK_SIZE];
+        if (encrypt)
+          aes.encrypt_cbc(o, n, count, chain);
+        else
+          aes.decrypt_cbc(o, n, count, chain);
+        i += count;
+      }
+      EXPECT(out == (encrypt ? ciphertext : cleartext),
+             "[%s] chained %s_cbc differs on %ld blocks", BACKEND_NAMES[b],
+             encrypt ? "encrypt" : "decrypt", blocks);
+      EXPECT(!blocks || !memcmp(chain, &ciphertext[size - AES_BLOCK_SIZE], AES_BLOCK_SIZE),
+             "[%s] %s_cbc leaves the wrong chain", BACKEND_NAMES[b],
+             encrypt ? "encrypt" : "decrypt");
+    }
+  }
+}
+
+// Pads and encrypts 'size' random bytes, and back.
+static void check_padded(size_t size, ThreadPool *pool) {
+  const std::string key = random_bytes(AES_KEY_SIZE);
+  const std::string iv = random_bytes(AES_BLOCK_SIZE);
+  const std::string cleartext = random_bytes(size);
+  const std::string ciphertext = reference_cbc(key, iv, true, true, cleartext);
+
+  std::string encrypted, decrypted;
+  EXPECT(!aes_cbc_encrypt((const unsigned char *)key.data(), (const unsigned char *)iv.data(),
+                          cleartext, &encrypted) && encrypted == ciphertext,
+         "aes_cbc_encrypt differs on %ld bytes", size);
+  EXPECT(!aes_cbc_decrypt((const unsigned char *)key.data(), (const unsigned char *)iv.data(),
+                          ciphertext, &decrypted, pool) && decrypted == cleartext,
+         "aes_cbc_decrypt differs on %ld bytes%s", size, pool ? " in parallel" : "");
+}
+
+// Decrypts ciphertexts whose padding comes out wrong, or whose size is
+// not a whole number of blocks. Flipping a byte of the block before
+// the last flips the same byte of the last plaintext block.
+static void check_bad_ciphertext() {
+  const std::string key = random_bytes(AES_KEY_SIZE);
+  const std::string iv = random_bytes(AES_BLOCK_SIZE);
+  std::string decrypted;
+
+  QuietStderr quiet;
+  const std::string ciphertext = reference_cbc(key, iv, true, true, random_bytes(20));
+  for (size_t i = 0; i < AES_BLOCK_SIZE; ++i) {
+    std::string bad = ciphertext;
+    bad[i] ^= 1 + random_length(254);
+    const bool valid = !reference_cbc(key, iv, false, true, bad).empty();
+    EXPECT((aes_cbc_decrypt((const unsigned char *)key.data(), (const unsigned char *)iv.data(),
+                            bad, &decrypted) == 0) == valid,
+           "aes_cbc_decrypt disagrees with EVP on a flipped byte at %ld", i);
+    // 12 bytes of padding; the length byte may flip into another one
+    if (i + 1 < AES_BLOCK_SIZE)
+      EXPECT(valid == (i < 4), "flipping byte %ld gets the padding wrong", i);
+  }
+  for (int i = 0; i < 64; ++i) {
+    // a random last block unpads with probability about 1/256: leave
+    // those to EVP to tell
+    const std::string ciphertext = random_bytes(AES_BLOCK_SIZE * (1 + random_length(4)));
+    const bool valid = !reference_cbc(key, iv, false, true, ciphertext).empty();
+    EXPECT((aes_cbc_decrypt((const unsigned char *)key.data(), (const unsigned char *)iv.data(),
+                            ciphertext, &decrypted) == 0) == valid,
+           "aes_cbc_decrypt disagrees with EVP on the padding of random blocks");
+  }
+  for (const size_t size : {0, 1, 15, 17, 33}) {
+    EXPECT(aes_cbc_decrypt((const unsigned char *)key.data(), (const unsigned char *)iv.data(),
+                           random_bytes(size), &decrypted) < 0,
+           "aes_cbc_decrypt accepts %ld bytes", size);
+  }
+}
+
+int main() {
+  for (size_t blocks = 0; blocks <= 40; ++blocks)
+    check_blocks(blocks, NULL);
+  for (size_t size = 0; size <= TEST_MAX_SHORT_LENGTH; ++size)
+    check_padded(size, NULL);
+  for (int i = 0; i < TEST_LONG_LENGTHS; ++i)
+    check_padded(random_length(TEST_MAX_LONG_LENGTH), NULL);
+
+  // parallel decryption starts at AES_CBC_PARALLEL_MIN_SIZE, in
+  // ranges of 256 KB and up
+  ThreadPool pool(4);
+  const size_t parallel_blocks = AES_CBC_PARALLEL_MIN_SIZE / AES_BLOCK_SIZE;
+  for (const size_t blocks : {(size_t)16, parallel_blocks - 1, parallel_blocks,
+                              parallel_blocks + 1, 4 * parallel_blocks + 7})
+    check_blocks(blocks, &pool);
+  for (const size_t size : {(size_t)100, AES_CBC_PARALLEL_MIN_SIZE - 1, AES_CBC_PARALLEL_MIN_SIZE,
+                            3 * AES_CBC_PARALLEL_MIN_SIZE + 5})
+    check_padded(size, &pool);
+
+  check_bad_ciphertext();
+
+  return test_result("aes_cbc_test");
+}
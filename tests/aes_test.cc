@@ -0,0 +1,144 @@
+#include <string.h>
+#include <string>
+#include <openssl/evp.h>
+#include "aes.h"
+#include "aes_ecb.h"
+#include "test_util.h"
+#include "thread_pool.h"
+
+static const AesBackend BACKENDS[] = {AES_BACKEND_TABLE, AES_BACKEND_AESNI, AES_BACKEND_OPENSSL};
+static const char *BACKEND_NAMES[] = {"table", "aesni", "openssl"};
+
+// AES-128-ECB of 's', a whole number of blocks, straight from EVP.
+static std::string reference_ecb(const std::string &key, const bool encrypt,
+                                 const std::string &s) {
+  EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+  std::string out(s.size() + AES_BLOCK_SIZE, '\0');
+  int size = 0, final_size = 0;
+  EVP_CipherInit_ex(ctx, EVP_aes_128_ecb(), NULL, (const unsigned char *)key.data(), NULL,
+                    encrypt);
+  EVP_CIPHER_CTX_set_padding(ctx, 0);
+  EVP_CipherUpdate(ctx, (unsigned char *)&out[0], &size, (const unsigned char *)s.data(),
+                   s.size());
+  EVP_CipherFinal_ex(ctx, (unsigned char *)&out[size], &final_size);
+  EVP_CIPHER_CTX_free(ctx);
+  out.resize(size + final_size);
+  return out;
+}
+
+// Runs Aes128 of each backend over 'blocks' random blocks, both ways,
+// by block, by ECB and in place.
+static void check_aes128(size_t blocks) {
+  const std::string key = random_bytes(AES_KEY_SIZE);
+  const std::string cleartext = random_bytes(blocks * AES_BLOCK_SIZE);
+  const std::string ciphertext = reference_ecb(key, true, cleartext);
+  const unsigned char *in = (const unsigned char *)cleartext.data();
+
+  for (int b = 0; b < 2; ++b) {
+    Aes128 aes(BACKENDS[b]);
+    aes.set_key((const unsigned char *)key.data());
+
+    std::string out(cleartext.size(), '\0');
+    aes.encrypt_ecb((unsigned char *)&out[0], in, blocks);
+    EXPECT(out == ciphertext, "Aes128 [%s] encrypt_ecb differs on %ld blocks",
+           BACKEND_NAMES[b], blocks);
+    aes.decrypt_ecb((unsigned char *)&out[0], (const unsigned char *)out.data(), blocks);
+    EXPECT(out == cleartext, "Aes128 [%s] in-place decrypt_ecb differs on %ld blocks",
+           BACKEND_NAMES[b], blocks);
+
+    for (size_t i = 0; i < blocks; ++i) {
+      unsigned char block[AES_BLOCK_SIZE];
+      aes.encrypt_block(block, in + i * AES_BLOCK_SIZE);
+      EXPECT(!memcmp(block, &ciphertext[i * AES_BLOCK_SIZE], AES_BLOCK_SIZE),
+             "Aes128 [%s] encrypt_block differs", BACKEND_NAMES[b]);
+      aes.decrypt_block(block, block);
+      EXPECT(!memcmp(block, in + i * AES_BLOCK_SIZE, AES_BLOCK_SIZE),
+             "Aes128 [%s] decrypt_block differs", BACKEND_NAMES[b]);
+    }
+  }
+}
+
+// Runs AesEcb of each backend over 'size' random bytes, both ways,
+// whole and in random chunks that split blocks.
+static void check_aes_ecb(size_t size) {
+  const std::string key = random_bytes(AES_KEY_SIZE);
+  const std::string cleartext = random_bytes(size - size % AES_BLOCK_SIZE);
+  const std::string ciphertext = reference_ecb(key, true, cleartext);
+
+  for (int b = 0; b < 3; ++b) {
+    AesEcb aes(BACKENDS[b]);
+    for (const bool encrypt : {true, false}) {
+      const std::string &in = encrypt ? cleartext : ciphertext;
+      const std::string &expected = encrypt ? ciphertext : cleartext;
+
+      std::string out(in.size(), '\0');
+      EXPECT(!aes.init((const unsigned char *)key.data(), encrypt) &&
+             !aes.process((unsigned char *)&out[0], (const unsigned char *)in.data(), in.size()) &&
+             out == expected, "AesEcb [%s] process differs on %ld bytes", BACKEND_NAMES[b],
+             in.size());
+
+      std::string streamed;
+      const AesEcb::Sink append = [&streamed](const unsigned char *data, size_t size) {
+        streamed.append((const char *)data, size);
+      };
+      bool failed = aes.init((const unsigned char *)key.data(), encrypt) < 0;
+      for (size_t i = 0; i < in.size();) {
+        size_t chunk = 1 + random_length(3 * AES_BLOCK_SIZE);
+        if (chunk > in.size() - i)
+          chunk = in.size() - i;
+        failed |= aes.update((const unsigned char *)&in[i], chunk, append) < 0;
+        i += chunk;
+      }
+      failed |= aes.finish() < 0;
+      EXPECT(!failed && streamed == expected, "AesEcb [%s] update differs on %ld bytes",
+             BACKEND_NAMES[b], in.size());
+    }
+
+    const unsigned char partial[2 * AES_BLOCK_SIZE] = {};
+    aes.init((const unsigned char *)key.data(), true);
+    const int updated = aes.update(partial, AES_BLOCK_SIZE + 1,
+                                   [](const unsigned char *, size_t) {});
+    int finished;
+    {
+      QuietStderr quiet;
+      finished = aes.finish();
+    }
+    EXPECT(updated == 0 && finished < 0, "AesEcb [%s] finish accepts a partial block",
+           BACKEND_NAMES[b]);
+  }
+}
+
+// Splits 'size' random bytes across the pool, in place or not.
+static void check_parallel(size_t size, ThreadPool *pool) {
+  const std::string key = random_bytes(AES_KEY_SIZE);
+  const std::string cleartext = random_bytes(size);
+  const std::string ciphertext = reference_ecb(key, true, cleartext);
+
+  std::string out(size, '\0');
+  EXPECT(!aes_ecb_parallel((const unsigned char *)key.data(), true, (unsigned char *)&out[0],
+                           (const unsigned char *)cleartext.data(), size, pool) &&
+         out == ciphertext, "aes_ecb_parallel differs on %ld bytes", size);
+  EXPECT(!aes_ecb_parallel((const unsigned char *)key.data(), false, (unsigned char *)&out[0],
+                           (const unsigned char *)out.data(), size, pool) &&
+         out == cleartext, "in-place aes_ecb_parallel differs on %ld bytes", size);
+}
+
+int main() {
+  // the AES-NI kernels go 8 blocks at a time: cover a few rounds of
+  // that and every remainder
+  for (size_t blocks = 0; blocks <= 40; ++blocks)
+    check_aes128(blocks);
+  for (int i = 0; i < TEST_LONG_LENGTHS; ++i)
+    check_aes128(random_length(TEST_MAX_LONG_LENGTH / AES_BLOCK_SIZE));
+
+  for (size_t size = 0; size <= TEST_MAX_SHORT_LENGTH; size += AES_BLOCK_SIZE)
+    check_aes_ecb(size);
+  for (int i = 0; i < TEST_LONG_LENGTHS; ++i)
+    check_aes_ecb(random_length(4 * TEST_MAX_LONG_LENGTH));
+
+  ThreadPool pool(4);
+  for (const size_t size : {0, 16, 4096, 1 << 20, (1 << 22) + 48})
+    check_parallel(size, &pool);
+
+  return test_result("aes_test");
+}
@@ -0,0 +1,96 @@
+#include <string>
+#include "base64.h"
+#include "test_util.h"
+
+static const char ALPHABET[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static std::string reference_encode(const std::string &s) {
+  std::string out;
+  for (size_t i = 0; i < s.size(); i += 3) {
+    const size_t left = s.size() - i;
+    uint32_t v = (unsigned char)s[i] << 16;
+    if (left > 1)
+      v |= (unsigned char)s[i + 1] << 8;
+    if (left > 2)
+      v |= (unsigned char)s[i + 2];
+    out += ALPHABET[v >> 18];
+    out += ALPHABET[(v >> 12) & 0x3f];
+    out += left > 1 ? ALPHABET[(v >> 6) & 0x3f] : '=';
+    out += left > 2 ? ALPHABET[v & 0x3f] : '=';
+  }
+  return out;
+}
+
+// Feeds 'text' to a Base64Decoder in random chunks.
+static int decode_in_chunks(const std::string &text, std::string *decoded) {
+  decoded->clear();
+  Base64Decoder decoder([decoded](const unsigned char *data, size_t size) {
+      decoded->append((const char *)data, size);
+    });
+  for (size_t i = 0; i < text.size();) {
+    const size_t chunk = 1 + random_length(97);
+    if (decoder.feed(std::string_view(text).substr(i, chunk)) < 0)
+      return -1;
+    i += chunk;
+  }
+  return decoder.finish();
+}
+
+static void check_round_trip(size_t size) {
+  const std::string bytes = random_bytes(size);
+  const std::string expected = reference_encode(bytes);
+
+  std::string encoded;
+  encodebase64(&encoded, bytes);
+  EXPECT(encoded == expected, "encodebase64 differs on %ld bytes", size);
+
+  std::string decoded;
+  EXPECT(!decodebase64(&decoded, expected) && decoded == bytes,
+         "decodebase64 differs on %ld bytes", size);
+
+  // wrapped at 60 chars, as in the challenge inputs
+  std::string wrapped;
+  for (size_t i = 0; i < expected.size(); i += 60)
+    wrapped += expected.substr(i, 60) + "\n";
+  EXPECT(!decode_in_chunks(wrapped, &decoded) && decoded == bytes,
+         "Base64Decoder differs on %ld bytes in chunks", size);
+}
+
+// Puts each of a few chars outside the alphabet at every position.
+static void check_invalid(size_t size) {
+  static const char invalid[] = {'-', '_', '.', ' ', '@', '[', '`', '{', '\0', (char)0x80,
+                                 (char)0xff};
+  const std::string text = reference_encode(random_bytes(size));
+
+  QuietStderr quiet;
+  std::string decoded;
+  for (size_t position = 0; position < text.size(); ++position) {
+    for (const char c : invalid) {
+      std::string bad = text;
+      bad[position] = c;
+      EXPECT(decodebase64(&decoded, bad) < 0, "decodebase64 accepts char %d at %ld of %ld",
+             (unsigned char)c, position, bad.size());
+    }
+  }
+
+  if (!text.empty()) {
+    // truncated quad, padding before the last quad
+    EXPECT(decodebase64(&decoded, text.substr(0, text.size() - 1)) < 0,
+           "decodebase64 accepts a truncated quad");
+    if (text.size() > 4)
+      EXPECT(decodebase64(&decoded, "AA==" + text) < 0,
+             "decodebase64 accepts padding in the middle");
+  }
+}
+
+int main() {
+  for (size_t size = 0; size <= TEST_MAX_SHORT_LENGTH; ++size) {
+    check_round_trip(size);
+    check_invalid(size);
+  }
+  for (int i = 0; i < TEST_LONG_LENGTHS; ++i)
+    check_round_trip(random_length(TEST_MAX_LONG_LENGTH));
+
+  return test_result("base64_test");
+}
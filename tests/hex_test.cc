@@ -0,0 +1,65 @@
+#include <string.h>
+#include <string>
+#include "hex.h"
+#include "test_util.h"
+
+static std::string reference_encode(const std::string &s) {
+  static const char digits[] = "0123456789abcdef";
+  std::string out;
+  for (const unsigned char c : s) {
+    out += digits[c >> 4];
+    out += digits[c & 0x0f];
+  }
+  return out;
+}
+
+// Encodes and decodes 'size' random bytes, in lower and upper case.
+static void check_round_trip(size_t size) {
+  const std::string bytes = random_bytes(size);
+  const std::string expected = reference_encode(bytes);
+
+  std::string encoded(2 * size, '\0');
+  hex_encode(&encoded[0], (const unsigned char *)bytes.data(), size);
+  EXPECT(encoded == expected, "hex_encode differs on %ld bytes", size);
+
+  std::string upper = expected;
+  for (size_t i = 0; i < upper.size(); i += 3)
+    upper[i] = toupper(upper[i]);
+  for (const std::string &digits : {expected, upper}) {
+    std::string decoded(size, '\0');
+    EXPECT(!hex_decode((unsigned char *)&decoded[0], digits.data(), digits.size()) &&
+           decoded == bytes, "hex_decode differs on %ld bytes", size);
+  }
+}
+
+// Puts each of a few non-hex chars at every position of 'size' bytes
+// worth of digits.
+static void check_invalid(size_t size) {
+  static const char invalid[] = {'g', 'G', '/', ':', '@', '`', ' ', '\n', '\0', (char)0x80,
+                                 (char)0xc1};
+  const std::string digits = reference_encode(random_bytes(size));
+  unsigned char out[TEST_MAX_SHORT_LENGTH];
+
+  QuietStderr quiet;
+  for (size_t position = 0; position < digits.size(); ++position) {
+    for (const char c : invalid) {
+      std::string bad = digits;
+      bad[position] = c;
+      EXPECT(hex_decode(out, bad.data(), bad.size()) < 0,
+             "hex_decode accepts char %d at %ld of %ld", (unsigned char)c, position, bad.size());
+    }
+  }
+  EXPECT(hex_decode(out, digits.data(), digits.size() ? digits.size() - 1 : 1) < 0 || !size,
+         "hex_decode accepts an odd size");
+}
+
+int main() {
+  for (size_t size = 0; size <= TEST_MAX_SHORT_LENGTH; ++size) {
+    check_round_trip(size);
+    check_invalid(size);
+  }
+  for (int i = 0; i < TEST_LONG_LENGTHS; ++i)
+    check_round_trip(random_length(TEST_MAX_LONG_LENGTH));
+
+  return test_result("hex_test");
+}
@@ -0,0 +1,103 @@
+#include <string>
+#include "pkcs7.h"
+#include "test_util.h"
+
+static const size_t BLOCK_SIZES[] = {1, 2, 8, 15, 16, 20, 128, 255};
+
+static std::string reference_pad(const std::string &s, const size_t block_size) {
+  const size_t padding = block_size - s.size() % block_size;
+  return s + std::string(padding, (char)padding);
+}
+
+// Pads 'size' random bytes both ways and takes the padding off again.
+static void check_round_trip(size_t size, const size_t block_size) {
+  const std::string message = random_bytes(size);
+  const std::string expected = reference_pad(message, block_size);
+
+  std::string padded = message;
+  padded.reserve(size + pkcs7_padding(size, block_size));
+  const char *data = padded.data();
+  EXPECT(!pkcs7_pad(&padded, block_size) && padded == expected && padded.data() == data,
+         "pkcs7_pad differs or reallocates on %ld bytes by %ld", size, block_size);
+
+  std::string buffer = message + std::string(block_size, '\0');
+  size_t padded_size = 0;
+  EXPECT(!pkcs7_pad((unsigned char *)&buffer[0], size, block_size, &padded_size) &&
+         padded_size == expected.size() && buffer.compare(0, expected.size(), expected) == 0,
+         "pkcs7_pad differs in place on %ld bytes by %ld", size, block_size);
+
+  size_t unpadded = 0;
+  EXPECT(!pkcs7_unpad((const unsigned char *)padded.data(), padded.size(), block_size,
+                      &unpadded) && unpadded == size,
+         "pkcs7_unpad gets %ld bytes instead of %ld by %ld", unpadded, size, block_size);
+  EXPECT(!pkcs7_unpad(&padded, block_size) && padded == message && padded.data() == data,
+         "pkcs7_unpad differs or reallocates on %ld bytes by %ld", size, block_size);
+}
+
+// Expects 'padded' to be rejected, leaving it and the size untouched.
+static void expect_rejected(const std::string &padded, const size_t block_size,
+                            const char *what) {
+  size_t unpadded = 0;
+  EXPECT(pkcs7_unpad((const unsigned char *)padded.data(), padded.size(), block_size,
+                     &unpadded) < 0 && unpadded == padded.size(),
+         "pkcs7_unpad accepts %s (%ld bytes by %ld)", what, padded.size(), block_size);
+  std::string s = padded;
+  EXPECT(pkcs7_unpad(&s, block_size) < 0 && s == padded,
+         "pkcs7_unpad changes %s (%ld bytes by %ld)", what, padded.size(), block_size);
+}
+
+// Spoils every byte of the padding of 'size' bytes but the last in
+// turn, then the last one (the padding length) with values no padding
+// can have; changing the bytes of the last block before the padding
+// must not matter.
+static void check_bad_padding(size_t size, const size_t block_size) {
+  const std::string padded = reference_pad(random_bytes(size), block_size);
+  for (size_t i = padded.size() - block_size; i + 1 < padded.size(); ++i) {
+    std::string bad = padded;
+    bad[i] ^= 1 + random_length(254);
+    if (i >= size) {
+      expect_rejected(bad, block_size, "a wrong padding byte");
+    } else {
+      size_t unpadded = 0;
+      EXPECT(!pkcs7_unpad((const unsigned char *)bad.data(), bad.size(), block_size,
+                          &unpadded) && unpadded == size,
+             "pkcs7_unpad rejects a change before the padding (%ld bytes by %ld)", size,
+             block_size);
+    }
+  }
+
+  std::string zero = padded;
+  zero.back() = 0;
+  expect_rejected(zero, block_size, "a zero padding length");
+  if (block_size < 255) {
+    std::string too_long = padded;
+    too_long.back() = block_size + 1;
+    expect_rejected(too_long, block_size, "a padding longer than a block");
+  }
+}
+
+int main() {
+  for (const size_t block_size : BLOCK_SIZES) {
+    for (size_t size = 0; size <= 600; ++size) {
+      check_round_trip(size, block_size);
+      check_bad_padding(size, block_size);
+    }
+  }
+
+  QuietStderr quiet;
+  const std::string block(16, '\x10');
+  expect_rejected("", 16, "an empty message");
+  expect_rejected(block.substr(1), 16, "a partial block");
+  expect_rejected(block + "\x01", 16, "a trailing byte");
+  expect_rejected(block, 0, "a block size of 0");
+  expect_rejected(std::string(256, '\x01'), 256, "a block size of 256");
+  std::string s = "message";
+  EXPECT(pkcs7_pad(&s, 0) < 0 && pkcs7_pad(&s, 256) < 0 && s == "message",
+         "pkcs7_pad accepts a bad block size");
+  unsigned char buffer[512] = {};
+  size_t padded = 0;
+  EXPECT(pkcs7_pad(buffer, 7, 0, &padded) < 0 && pkcs7_pad(buffer, 7, 256, &padded) < 0 &&
+         buffer[7] == 0 && padded == 0, "pkcs7_pad accepts a bad block size in place");
+
+  return test_result("pkcs7_test");
+}
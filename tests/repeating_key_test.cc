@@ -0,0 +1,84 @@
+#include <string>
+#include <vector>
+#include "repeating_key.h"
+#include "test_util.h"
+
+static std::string reference_xor(const std::string &key, const std::string &s) {
+  std::string out(s);
+  for (size_t i = 0; i < out.size(); ++i)
+    out[i] ^= key[i % key.size()];
+  return out;
+}
+
+// Xors 'size' bytes with 'key' in one go, in place, and in random
+// chunks through one RepeatingKeyXor.
+static void check_key(const std::string &key, size_t size) {
+  const std::string s = random_bytes(size);
+  const std::string expected = reference_xor(key, s);
+
+  EXPECT(repkey_xor(key, s) == expected, "repkey_xor differs, key of %ld, %ld bytes",
+         key.size(), size);
+
+  std::string in_place = s;
+  repkey_xor(key, &in_place);
+  EXPECT(in_place == expected, "in-place repkey_xor differs, key of %ld, %ld bytes",
+         key.size(), size);
+
+  RepeatingKeyXor xor_key(key);
+  std::string chunked(size, '\0');
+  for (size_t i = 0; i < size;) {
+    size_t chunk = 1 + random_length(70);
+    if (chunk > size - i)
+      chunk = size - i;
+    xor_key.apply((unsigned char *)&chunked[i], (const unsigned char *)s.data() + i, chunk);
+    i += chunk;
+  }
+  EXPECT(chunked == expected, "chunked RepeatingKeyXor differs, key of %ld, %ld bytes",
+         key.size(), size);
+
+  xor_key.rewind();
+  std::string rewound(size, '\0');
+  xor_key.apply((unsigned char *)&rewound[0], (const unsigned char *)s.data(), size);
+  EXPECT(rewound == expected, "rewound RepeatingKeyXor differs, key of %ld, %ld bytes",
+         key.size(), size);
+}
+
+int main() {
+  // the pattern period is lcm(key, 32) up to 4096 bytes, and the key
+  // size past that: 129 and up with odd sizes, 4097 and up otherwise
+  std::vector<size_t> key_sizes;
+  for (size_t k = 1; k <= 80; ++k)
+    key_sizes.push_back(k);
+  for (size_t k : {127, 128, 129, 255, 4095, 4096, 4097, 5000})
+    key_sizes.push_back(k);
+
+  for (const size_t key_size : key_sizes) {
+    const std::string key = random_bytes(key_size);
+    for (size_t size = 0; size <= TEST_MAX_SHORT_LENGTH; ++size)
+      check_key(key, size);
+    for (int i = 0; i < 4; ++i)
+      check_key(key, random_length(TEST_MAX_LONG_LENGTH));
+  }
+
+  // a key repeated, or nearly
+  for (size_t period = 1; period <= 20; ++period) {
+    const std::string key = random_bytes(period);
+    if (key_period(key) != period)
+      continue;
+    for (size_t times = 1; times <= 4; ++times) {
+      std::string repeated;
+      for (size_t i = 0; i < times; ++i)
+        repeated += key;
+      EXPECT(key_period(repeated) == period, "key_period gets %ld for %ld bytes %ld times",
+             key_period(repeated), period, times);
+      repeated.back() ^= 1;
+      EXPECT(key_period(repeated) == repeated.size(),
+             "key_period gets %ld for %ld bytes %ld times, but the last",
+             key_period(repeated), period, times);
+    }
+  }
+  EXPECT(key_period("abcab") == 5, "key_period takes a non-divisor");
+  EXPECT(key_period("aaaa") == 1, "key_period misses a single byte key");
+
+  return test_result("repeating_key_test");
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <random>
+#include <string>
+
+// Shared by the tests: each one checks its module against a plain
+// reference or OpenSSL, and CTest runs it under every SIMD level (see
+// CMakeLists.txt), so the kernels are held to the same results.
+
+// failed checks so far
+inline int test_failures = 0;
+
+// Reports a failed check, with printf-style details, and counts it.
+#define EXPECT(condition, ...)                                  \
+  do {                                                          \
+    if (!(condition)) {                                         \
+      fprintf(stderr, "%s:%d: ", __FILE__, __LINE__);           \
+      fprintf(stderr, __VA_ARGS__);                             \
+      fputc('\n', stderr);                                      \
+      ++test_failures;                                          \
+    }                                                           \
+  } while (0)
+
+// What main() returns: 0 if every check passed.
+inline int test_result(const char *name) {
+  fprintf(stderr, "%s: %d failed checks\n", name, test_failures);
+  return test_failures ? 1 : 0;
+}
+
+// lengths to try: everything around the vector widths, then a few
+// larger random ones
+static const size_t TEST_MAX_SHORT_LENGTH = 64;
+static const int TEST_LONG_LENGTHS = 32;
+static const size_t TEST_MAX_LONG_LENGTH = 1 << 16;
+
+inline std::mt19937 &test_rng() {
+  static std::mt19937 rng(12345);
+  return rng;
+}
+
+inline std::string random_bytes(size_t size) {
+  std::string s(size, '\0');
+  for (char &c : s)
+    c = test_rng()();
+  return s;
+}
+
+inline size_t random_length(size_t max) {
+  return test_rng()() % (max + 1);
+}
+
+// Sends stderr to /dev/null while in scope, for the checks that expect
+// the code under test to report errors.
+class QuietStderr {
+ public:
+  QuietStderr() : saved_(dup(STDERR_FILENO)) {
+    fflush(stderr);
+    const int null = open("/dev/null", O_WRONLY);
+    dup2(null, STDERR_FILENO);
+    close(null);
+  }
+  ~QuietStderr() {
+    fflush(stderr);
+    dup2(saved_, STDERR_FILENO);
+    close(saved_);
+  }
+
+  QuietStderr(const QuietStderr &) = delete;
+  QuietStderr &operator=(const QuietStderr &) = delete;
+
+ private:
+  int saved_;
+};